@@ -1,3 +1,7 @@
+import argparse
+
+import onnx
+from onnx import TensorProto, helper
 from transformers import MarianMTModel
 from optimum.exporters.onnx import main_export
 from optimum.exporters.onnx.config import OnnxConfig
@@ -6,9 +10,62 @@ from pathlib import Path
 model_id = "Helsinki-NLP/opus-mt-en-ru"
 output_dir = Path("../models/opus-mt-en-ru")
 
+
+def append_top_k_head(path, k):
+    """Заменяет выход logits [batch, t, vocab] на k лучших токенов последней позиции.
+
+    В граф добавляются Gather(-1) по оси t, LogSoftmax и TopK: декодер возвращает
+    top_log_probs [batch, k] и top_token_ids [batch, k] вместо всех логитов.
+    Translator обнаруживает эти выходы автоматически.
+    """
+    model = onnx.load(str(path))
+    graph = model.graph
+
+    graph.initializer.extend([
+        helper.make_tensor("head_last_position", TensorProto.INT64, [], [-1]),
+        helper.make_tensor("head_k", TensorProto.INT64, [1], [k]),
+    ])
+    graph.node.extend([
+        helper.make_node("Gather", ["logits", "head_last_position"], ["head_last_logits"], axis=1),
+        helper.make_node("LogSoftmax", ["head_last_logits"], ["head_log_probs"], axis=-1),
+        helper.make_node("TopK", ["head_log_probs", "head_k"], ["top_log_probs", "top_token_ids"],
+                         axis=-1, largest=1, sorted=1),
+    ])
+
+    outputs = [output for output in graph.output if output.name != "logits"]
+    del graph.output[:]
+    graph.output.extend([
+        helper.make_tensor_value_info("top_log_probs", TensorProto.FLOAT, ["batch_size", k]),
+        helper.make_tensor_value_info("top_token_ids", TensorProto.INT64, ["batch_size", k]),
+    ])
+    graph.output.extend(outputs)
+    onnx.save(model, str(path))
+
+
+parser = argparse.ArgumentParser(description="Экспорт opus-mt в ONNX для Translator")
+parser.add_argument("--top-k", type=int, default=0,
+                    help="добавить в декодеры голову LogSoftmax + TopK с k лучшими токенами "
+                         "(не меньше удвоенной ширины луча); 0 — возвращать все логиты")
+args = parser.parse_args()
+
+# Экспорт с кешем ключей/значений: помимо encoder_model.onnx и decoder_model.onnx
+# (который теперь также возвращает present.*) создаётся decoder_with_past_model.onnx,
+# обрабатывающий на каждом шаге только новый токен.
 main_export(
     model_name_or_path=model_id,
     output=output_dir,
-    task="translation",
+    task="text2text-generation-with-past",
     no_post_process=True,
 )
+
+# Имена файлов, которые ожидает Translator.
+for exported, name in [
+    ("encoder_model.onnx", "encoder.onnx"),
+    ("decoder_model.onnx", "decoder.onnx"),
+    ("decoder_with_past_model.onnx", "decoder_with_past.onnx"),
+]:
+    (output_dir / exported).replace(output_dir / name)
+
+if args.top_k > 0:
+    for name in ["decoder.onnx", "decoder_with_past.onnx"]:
+        append_top_k_head(output_dir / name, args.top_k)
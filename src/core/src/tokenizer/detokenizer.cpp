@@ -0,0 +1,9 @@
+#include "detokenizer.hpp"
+
+IncrementalDetokenizer::IncrementalDetokenizer(const Tokenizer &tokenizer)
+    : vocab(tokenizer.vocabulary()) {}
+
+std::string_view IncrementalDetokenizer::push(int64_t id) {
+    size_t added = vocab->append_token(id, decoded);
+    return std::string_view(decoded).substr(decoded.size() - added);
+}
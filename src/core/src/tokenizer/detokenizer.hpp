@@ -0,0 +1,53 @@
+#pragma once
+
+#include "tokenizer.hpp"
+#include "vocabulary.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Потоковый детокенизатор: принимает токены по одному.
+ *
+ * В отличие от Tokenizer::decode не декодирует заново весь префикс, а дописывает
+ * к накопленному тексту только новый токен, поэтому вывод частичного перевода
+ * на каждом шаге генерации стоит O(1) на токен. Результат совпадает с decode
+ * для той же последовательности: служебные токены пропускаются, "▁" превращается
+ * в пробел между словами.
+ *
+ * Пример:
+ *   IncrementalDetokenizer stream(tokenizer);
+ *   for (int64_t id : ids)
+ *       std::cout << stream.push(id);
+ */
+class IncrementalDetokenizer {
+public:
+    /**
+     * @brief Создаёт детокенизатор для словаря токенизатора.
+     * @param tokenizer Токенизатор, словарь которого используется.
+     */
+    explicit IncrementalDetokenizer(const Tokenizer &tokenizer);
+
+    /**
+     * @brief Добавляет токен и возвращает появившийся текст.
+     * @param id Идентификатор токена.
+     * @return Новый фрагмент текста (пустой для служебных токенов); действителен
+     *         до следующего вызова push или reset.
+     */
+    std::string_view push(int64_t id);
+
+    /**
+     * @brief Возвращает весь текст, накопленный с последнего reset.
+     */
+    const std::string &text() const { return decoded; }
+
+    /**
+     * @brief Сбрасывает накопленный текст, сохраняя выделенную память.
+     */
+    void reset() { decoded.clear(); }
+
+private:
+    std::shared_ptr<const Vocabulary> vocab; ///< Словарь для поиска токенов.
+    std::string decoded;                     ///< Накопленный текст.
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "trie.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Таблицы словаря, вкомпилированные в программу.
+ *
+ * Исходник с этими таблицами генерируется командой
+ * `vocab_compiler --emit-cpp vocab.json embedded_vocab.cpp` при сборке с опцией
+ * TOKENIZER_EMBED_VOCAB. Все массивы — constexpr-данные только для чтения.
+ */
+struct EmbeddedVocab {
+    const uint32_t *offsets;            ///< Смещения токенов в пуле (token_count + 1 значений).
+    const uint8_t *flags;               ///< Признаки токенов (TokenFlags).
+    const char *pool;                   ///< Пул строк токенов.
+    size_t token_count;                 ///< Количество идентификаторов.
+    const DoubleArrayTrie::Unit *trie;  ///< Ячейки двойного массива.
+    size_t trie_size;                   ///< Количество ячеек двойного массива.
+    const uint32_t *hash_seeds;         ///< Seed корзин совершенной хеш-функции.
+    size_t bucket_count;                ///< Количество корзин.
+    const int32_t *hash_slots;          ///< Ячейки совершенной хеш-функции.
+    size_t slot_count;                  ///< Количество ячеек.
+};
+
+#ifdef TOKENIZER_EMBEDDED_VOCAB
+/**
+ * @brief Возвращает вкомпилированный словарь (определяется в сгенерированном исходнике).
+ */
+const EmbeddedVocab &embedded_vocab();
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Файл, отображённый в память только для чтения.
+ *
+ * Страницы файла разделяются между всеми процессами, отобразившими один и тот же
+ * файл, и подгружаются операционной системой по мере обращения.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Отображает файл в память.
+     * @param path Путь к файлу.
+     * @throws std::runtime_error Если файл не удалось открыть или отобразить.
+     */
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Возвращает указатель на начало отображённых данных.
+     */
+    const char *data() const { return static_cast<const char *>(address); }
+
+    /**
+     * @brief Возвращает размер файла в байтах.
+     */
+    size_t size() const { return length; }
+
+private:
+    void *address = nullptr; ///< Адрес отображения.
+    size_t length = 0;       ///< Размер отображения в байтах.
+#ifdef _WIN32
+    void *mapping = nullptr; ///< Дескриптор объекта отображения (Windows).
+#endif
+};
@@ -0,0 +1,80 @@
+#include "perfect_hash.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kKeysPerBucket = 4;
+
+} // namespace
+
+PerfectHash build_perfect_hash(const std::vector<std::pair<std::string, int64_t>> &entries) {
+    PerfectHash result;
+    size_t slot_count = entries.size();
+    if (slot_count == 0)
+        return result;
+
+    // Ключи с одинаковым базовым хешем всегда попадают в одну ячейку, и подбор
+    // seed перебрал бы все 2^32 значений; такие ключи отвергаются сразу.
+    std::vector<std::pair<uint64_t, size_t>> bases;
+    bases.reserve(slot_count);
+    for (size_t i = 0; i < slot_count; ++i)
+        bases.emplace_back(perfect_hash_base(entries[i].first.data(), entries[i].first.size()), i);
+    std::sort(bases.begin(), bases.end());
+    for (size_t i = 1; i < bases.size(); ++i)
+        if (bases[i].first == bases[i - 1].first)
+            throw std::runtime_error("Failed to build perfect hash: tokens \"" +
+                                     entries[bases[i - 1].second].first + "\" and \"" +
+                                     entries[bases[i].second].first + "\" share a hash");
+
+    size_t bucket_count = slot_count / kKeysPerBucket + 1;
+    std::vector<std::vector<uint64_t>> buckets(bucket_count);
+    std::vector<std::vector<int32_t>> bucket_ids(bucket_count);
+    for (const auto &[base, index] : bases) {
+        buckets[base % bucket_count].push_back(base);
+        bucket_ids[base % bucket_count].push_back(static_cast<int32_t>(entries[index].second));
+    }
+
+    std::vector<size_t> order(bucket_count);
+    for (size_t i = 0; i < bucket_count; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    result.seeds.assign(bucket_count, 0);
+    result.slots.assign(slot_count, -1);
+    std::vector<size_t> taken;
+
+    for (size_t bucket : order) {
+        const std::vector<uint64_t> &keys = buckets[bucket];
+        if (keys.empty())
+            break;
+
+        for (uint32_t seed = 0;; ++seed) {
+            if (seed == UINT32_MAX)
+                throw std::runtime_error("Failed to build perfect hash");
+
+            taken.clear();
+            bool fits = true;
+            for (uint64_t base : keys) {
+                size_t slot = perfect_hash_mix(base, seed) % slot_count;
+                if (result.slots[slot] >= 0 ||
+                    std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                    fits = false;
+                    break;
+                }
+                taken.push_back(slot);
+            }
+
+            if (fits) {
+                result.seeds[bucket] = seed;
+                for (size_t i = 0; i < keys.size(); ++i)
+                    result.slots[taken[i]] = bucket_ids[bucket][i];
+                break;
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Минимальная совершенная хеш-функция (схема hash-and-displace).
+ *
+ * Ключи распределяются по корзинам базовым хешем; для каждой корзины
+ * подбирается число seed, при котором все её ключи попадают в свободные
+ * ячейки таблицы размера ровно в количество ключей. Поиск — одно обращение
+ * к таблице без цепочек коллизий; найденный кандидат нужно сверить с ключом.
+ */
+struct PerfectHash {
+    std::vector<uint32_t> seeds; ///< Seed для каждой корзины.
+    std::vector<int32_t> slots;  ///< Идентификатор токена для каждой ячейки.
+};
+
+/**
+ * @brief Базовый 64-битный хеш ключа.
+ */
+constexpr uint64_t perfect_hash_base(const char *key, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ static_cast<unsigned char>(key[i])) * 0x100000001b3ull;
+    return hash;
+}
+
+/**
+ * @brief Перемешивает базовый хеш с seed корзины.
+ */
+constexpr uint64_t perfect_hash_mix(uint64_t base, uint32_t seed) {
+    uint64_t x = base ^ (uint64_t(seed) * 0x9e3779b97f4a7c15ull);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Возвращает идентификатор-кандидат для ключа.
+ * @param seeds Seed корзин.
+ * @param bucket_count Количество корзин.
+ * @param slots Таблица идентификаторов.
+ * @param slot_count Размер таблицы.
+ * @param key Указатель на ключ.
+ * @param length Длина ключа.
+ * @return Идентификатор, который нужно сверить с ключом, или -1 для пустой таблицы.
+ */
+constexpr int64_t perfect_hash_candidate(const uint32_t *seeds, size_t bucket_count,
+                                         const int32_t *slots, size_t slot_count,
+                                         const char *key, size_t length) {
+    if (bucket_count == 0 || slot_count == 0)
+        return -1;
+    uint64_t base = perfect_hash_base(key, length);
+    uint32_t seed = seeds[base % bucket_count];
+    return slots[perfect_hash_mix(base, seed) % slot_count];
+}
+
+/**
+ * @brief Строит минимальную совершенную хеш-функцию для токенов.
+ * @param entries Пары {токен, идентификатор} с различными токенами.
+ * @return Таблицы seed и ячеек.
+ * @throws std::runtime_error Если у двух токенов совпадает базовый хеш (в том
+ *         числе если токены повторяются): такие ключи не разделить никаким seed.
+ */
+PerfectHash build_perfect_hash(const std::vector<std::pair<std::string, int64_t>> &entries);
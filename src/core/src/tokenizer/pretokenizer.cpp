@@ -0,0 +1,69 @@
+#include "pretokenizer.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PRETOKENIZER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PRETOKENIZER_SSE2 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(PRETOKENIZER_AVX2)
+
+// Маска пробельных байт для 32 байт: ' ' или '\t'..'\r'.
+uint64_t space_mask_simd(const char *block) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    __m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+    __m256i space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(control, space)));
+}
+
+constexpr size_t kSimdWidth = 32;
+
+#elif defined(PRETOKENIZER_SSE2)
+
+// Маска пробельных байт для 16 байт: ' ' или '\t'..'\r'.
+uint64_t space_mask_simd(const char *block) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+    __m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(control, space)));
+}
+
+constexpr size_t kSimdWidth = 16;
+
+#endif
+
+} // namespace
+
+uint64_t space_mask(const char *data, size_t length) {
+    uint64_t mask = 0;
+    size_t i = 0;
+#if defined(PRETOKENIZER_AVX2) || defined(PRETOKENIZER_SSE2)
+    for (; i + kSimdWidth <= length && i < kSpaceMaskBlock; i += kSimdWidth)
+        mask |= space_mask_simd(data + i) << i;
+#endif
+    for (; i < length && i < kSpaceMaskBlock; ++i)
+        mask |= uint64_t(is_space_byte(data[i])) << i;
+    if (length < kSpaceMaskBlock)
+        mask |= ~0ull << length;
+    return mask;
+}
+
+size_t WordSplitter::count_trailing_zeros(uint64_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctzll(bits));
+#endif
+}
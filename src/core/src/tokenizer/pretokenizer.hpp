@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Размер блока, для которого строится маска пробельных байт.
+ */
+constexpr size_t kSpaceMaskBlock = 64;
+
+/**
+ * @brief Проверяет, является ли байт пробельным (как isspace в локали "C").
+ */
+inline bool is_space_byte(char c) {
+    unsigned char u = static_cast<unsigned char>(c);
+    return u == ' ' || (u >= '\t' && u <= '\r');
+}
+
+/**
+ * @brief Строит маску пробельных байт блока текста.
+ * @param data Указатель на начало блока.
+ * @param length Количество доступных байт (может быть меньше kSpaceMaskBlock).
+ * @return Маска, где бит i установлен, если data[i] пробельный; биты с
+ *         индексами length и выше тоже установлены.
+ *
+ * Полные блоки классифицируются инструкциями AVX2 (если сборка с AVX2)
+ * или SSE2, на остальных платформах и для хвоста используется скалярный код.
+ */
+uint64_t space_mask(const char *data, size_t length);
+
+/**
+ * @brief Предтокенизатор: разбивает текст на слова по пробельным символам.
+ *
+ * Текст проходится один раз блоками по kSpaceMaskBlock байт: для блока строится
+ * маска пробельных символов, а границы слов находятся по её битам. Серии
+ * пробельных символов схлопываются, слова возвращаются как представления
+ * исходного текста, поэтому разбиение не выделяет память.
+ *
+ * Пример:
+ *   WordSplitter words(" Hello\t\nWorld ");
+ *   std::string_view word;
+ *   while (words.next(word)) { ... } // "Hello", "World"
+ */
+class WordSplitter {
+public:
+    /**
+     * @brief Создаёт разбиение для текста; текст должен жить дольше объекта.
+     */
+    explicit WordSplitter(std::string_view text) : text(text) { load(0); }
+
+    /**
+     * @brief Переходит к следующему слову.
+     * @param word Заполняется представлением слова.
+     * @return false, если слов больше нет.
+     */
+    bool next(std::string_view &word) {
+        size_t start = find(false);
+        if (start == text.size())
+            return false;
+
+        size_t end = find(true);
+        word = text.substr(start, end - start);
+        return true;
+    }
+
+private:
+    std::string_view text; ///< Разбиваемый текст.
+    size_t base = 0;       ///< Начало текущего блока.
+    size_t offset = 0;     ///< Позиция внутри блока, с которой продолжается поиск.
+    uint64_t spaces = 0;   ///< Маска пробельных байт текущего блока.
+
+    void load(size_t block) {
+        base = block;
+        offset = 0;
+        spaces = block < text.size() ? space_mask(text.data() + block, text.size() - block) : ~0ull;
+    }
+
+    // Возвращает позицию первого пробельного (space == true) или непробельного байта.
+    size_t find(bool space) {
+        for (;;) {
+            if (offset < kSpaceMaskBlock) {
+                uint64_t bits = (space ? spaces : ~spaces) & (~0ull << offset);
+                if (bits) {
+                    offset = count_trailing_zeros(bits);
+                    return base + offset;
+                }
+            }
+            if (base + kSpaceMaskBlock >= text.size()) {
+                offset = kSpaceMaskBlock;
+                return text.size();
+            }
+            load(base + kSpaceMaskBlock);
+        }
+    }
+
+    static size_t count_trailing_zeros(uint64_t bits);
+};
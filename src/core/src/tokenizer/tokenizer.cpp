@@ -1,91 +1,95 @@
 #include "tokenizer.hpp"
-#include <cctype>
-#include <fstream>
-#include <nlohmann/json.hpp>
-#include <sstream>
+#include "pretokenizer.hpp"
 #include <stdexcept>
+#include <utility>
 
 const std::string Tokenizer::spm_space = "▁";
 
-Tokenizer::Tokenizer(const std::string &vocab_path) {
-    std::ifstream file(vocab_path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open vocab file: " + vocab_path);
-    }
-
-    nlohmann::json j;
-    file >> j;
+Tokenizer::Tokenizer(const std::string &vocab_path) : vocab(Vocabulary::load(vocab_path)) {}
 
-    for (auto &[token, id] : j.items()) {
-        token_to_id[token] = id;
-        id_to_token[id] = token;
-    }
+Tokenizer::Tokenizer(std::shared_ptr<const Vocabulary> vocabulary) : vocab(std::move(vocabulary)) {
+    if (!vocab)
+        throw std::invalid_argument("vocabulary is null");
 }
 
-std::string Tokenizer::normalize(const std::string &text) {
+std::string Tokenizer::normalize(const std::string &text) const {
     std::string result;
-
-    for (char c : text) {
-        result += isspace(static_cast<unsigned char>(c)) ? ' ' : c;
+    result.reserve(text.size());
+
+    WordSplitter words(text);
+    std::string_view word;
+    while (words.next(word)) {
+        if (!result.empty())
+            result += ' ';
+        result.append(word.data(), word.size());
     }
     return result;
 }
 
-std::vector<int64_t> Tokenizer::encode(const std::string &input_text) {
+std::vector<int64_t> Tokenizer::encode(const std::string &input_text) const {
     std::vector<int64_t> tokens;
-    std::istringstream stream(normalize(input_text));
-    std::string word;
-
-    while (stream >> word) {
-        std::string current = spm_space + word;
-        size_t pos = 0;
-
-        while (pos < current.size()) {
-            size_t len = current.size();
-            bool found = false;
-
-            while (len > 0) {
-                std::string sub = current.substr(pos, len);
-                if (token_to_id.count(sub)) {
-                    tokens.push_back(token_to_id[sub]);
-                    pos += len;
-                    found = true;
-                    break;
-                }
-                --len;
-            }
-
-            if (!found) {
-                tokens.push_back(token_to_id.at("<unk>"));
-                break;
-            }
-        }
-    }
-
+    encode_into(input_text, tokens);
     return tokens;
 }
 
-std::string Tokenizer::decode(const std::vector<int64_t> &token_ids) {
-    std::string result;
+void Tokenizer::encode_into(std::string_view text, std::vector<int64_t> &tokens) const {
+    tokens.clear();
+
+    WordSplitter words(text);
+    std::string_view word;
+    while (words.next(word))
+        encode_word(word.data(), word.size(), tokens);
+}
 
-    for (size_t i = 0; i < token_ids.size(); ++i) {
-        int64_t id = token_ids[i];
+void Tokenizer::enable_word_cache(size_t capacity) {
+    cache = std::make_shared<WordCache>(capacity);
+}
 
-        if (!id_to_token.count(id))
-            continue;
+void Tokenizer::encode_word(const char *word, size_t length, std::vector<int64_t> &tokens) const {
+    if (cache) {
+        if (cache->lookup(std::string_view(word, length), tokens))
+            return;
 
-        std::string token = id_to_token[id];
-        if (token == "<pad>" || token == "<s>" || token == "</s>")
-            continue;
+        size_t first = tokens.size();
+        encode_word_uncached(word, length, tokens);
+        cache->insert(std::string_view(word, length), tokens.data() + first, tokens.size() - first);
+        return;
+    }
 
-        if (token.rfind(spm_space, 0) == 0) {
-            if (!result.empty())
-                result += " ";
-            result += token.substr(3);
-        } else {
-            result += token;
+    encode_word_uncached(word, length, tokens);
+}
+
+void Tokenizer::encode_word_uncached(const char *word, size_t length,
+                                     std::vector<int64_t> &tokens) const {
+    size_t pos = 0;
+    size_t len = 0;
+    int64_t id = vocab->longest_word_start_match(word, length, len);
+
+    for (;;) {
+        if (id < 0) {
+            if (vocab->unk_id() < 0)
+                throw std::out_of_range("Vocab has no <unk> token");
+            tokens.push_back(vocab->unk_id());
+            return;
         }
+
+        tokens.push_back(id);
+        pos += len;
+        if (pos >= length)
+            return;
+
+        id = vocab->longest_match(word + pos, length - pos, len);
     }
+}
 
+std::string Tokenizer::decode(const std::vector<int64_t> &token_ids) const {
+    std::string result;
+    decode_into(token_ids.data(), token_ids.size(), result);
     return result;
 }
+
+void Tokenizer::decode_into(const int64_t *token_ids, size_t count, std::string &result) const {
+    result.clear();
+    for (size_t i = 0; i < count; ++i)
+        vocab->append_token(token_ids[i], result);
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "vocabulary.hpp"
+#include "word_cache.hpp"
 #include <cstdint>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 /**
@@ -10,24 +13,48 @@
  *
  * Этот класс загружает словарь из JSON-файла и использует его для кодирования
  * текста в последовательность идентификаторов токенов и декодирования обратно в текст.
+ * Вместо JSON можно передать бинарный словарь, собранный утилитой vocab_compiler:
+ * он отображается в память и используется напрямую, без разбора.
+ *
+ * Сам словарь хранится в неизменяемом объекте Vocabulary, который разделяется
+ * между копиями токенизатора, поэтому копирование Tokenizer почти бесплатно.
  */
 class Tokenizer {
 public:
     /**
      * @brief Конструктор, загружающий словарь из файла.
-     * @param vocab_path Путь к JSON-файлу со словарем.
+     * @param vocab_path Путь к JSON-файлу со словарем или к бинарному словарю.
      * @throws std::runtime_error Если файл не удалось открыть или прочитать.
      *
      */
     Tokenizer(const std::string &vocab_path);
 
+    /**
+     * @brief Конструктор, использующий уже загруженный словарь.
+     * @param vocabulary Разделяемый словарь.
+     * @throws std::invalid_argument Если словарь не задан.
+     *
+     */
+    explicit Tokenizer(std::shared_ptr<const Vocabulary> vocabulary);
+
     /**
      * @brief Кодирует текст в последовательность идентификаторов токенов.
      * @param text Входной текст для кодирования.
      * @return Вектор идентификаторов токенов.
      *
      */
-    std::vector<int64_t> encode(const std::string &text);
+    std::vector<int64_t> encode(const std::string &text) const;
+
+    /**
+     * @brief Кодирует текст в буфер, принадлежащий вызывающему.
+     * @param text Входной текст для кодирования.
+     * @param tokens Буфер для идентификаторов; очищается, ёмкость сохраняется.
+     *
+     * Слова выделяются предтокенизатором WordSplitter прямо при проходе по
+     * тексту, без нормализованной копии и без потоков ввода, поэтому при
+     * достаточной ёмкости буфера метод не выделяет память.
+     */
+    void encode_into(std::string_view text, std::vector<int64_t> &tokens) const;
 
     /**
      * @brief Декодирует последовательность идентификаторов токенов в текст.
@@ -35,18 +62,84 @@ public:
      * @return Декодированный текст.
      *
      */
-    std::string decode(const std::vector<int64_t> &token_ids);
+    std::string decode(const std::vector<int64_t> &token_ids) const;
 
     /**
-     * @brief Нормализует текст, заменяя пробельные символы на одиночные пробелы.
+     * @brief Декодирует идентификаторы в строку, принадлежащую вызывающему.
+     * @param token_ids Указатель на идентификаторы токенов.
+     * @param count Количество идентификаторов.
+     * @param text Буфер для текста; очищается, ёмкость сохраняется.
+     */
+    void decode_into(const int64_t *token_ids, size_t count, std::string &text) const;
+
+    /**
+     * @brief Нормализует текст: схлопывает серии пробельных символов в одиночные
+     *        пробелы и убирает пробелы по краям.
      * @param text Входной текст для нормализации.
      * @return Нормализованный текст.
      *
      */
-    std::string normalize(const std::string &text);
+    std::string normalize(const std::string &text) const;
+
+    /**
+     * @brief Возвращает текст токена по идентификатору.
+     * @param id Идентификатор токена.
+     * @return Представление строки токена внутри словаря или пустая строка,
+     *         если идентификатора нет в словаре.
+     */
+    std::string_view id_to_token(int64_t id) const { return vocab->token(id); }
+
+    /**
+     * @brief Возвращает идентификатор токена.
+     * @param token Текст токена.
+     * @return Идентификатор или -1, если токена нет в словаре.
+     */
+    int64_t token_to_id(std::string_view token) const { return vocab->find(token); }
+
+    /**
+     * @brief Включает кэш разбиения слов на токены.
+     * @param capacity Максимальное количество слов в кэше.
+     *
+     * Копии токенизатора, сделанные после вызова, разделяют один кэш;
+     * кэш потокобезопасен.
+     *
+     * Пример:
+     *   tokenizer.enable_word_cache(50000);
+     *   tokenizer.word_cache()->stats().hits;
+     */
+    void enable_word_cache(size_t capacity);
+
+    /**
+     * @brief Отключает кэш разбиения слов.
+     */
+    void disable_word_cache() { cache.reset(); }
+
+    /**
+     * @brief Возвращает кэш разбиения слов или nullptr, если он выключен.
+     */
+    const std::shared_ptr<WordCache> &word_cache() const { return cache; }
+
+    /**
+     * @brief Возвращает разделяемый словарь токенизатора.
+     */
+    const std::shared_ptr<const Vocabulary> &vocabulary() const { return vocab; }
 
-    std::unordered_map<std::string, int64_t> token_to_id; ///< Маппинг токенов в их идентификаторы.
-    std::unordered_map<int64_t, std::string> id_to_token; ///< Маппинг идентификаторов в токены.
     static const std::string spm_space; ///< Специальный префикс для токенов
 
+private:
+    std::shared_ptr<const Vocabulary> vocab; ///< Разделяемый неизменяемый словарь.
+    std::shared_ptr<WordCache> cache;        ///< Необязательный кэш разбиения слов.
+
+    /**
+     * @brief Кодирует одно слово (без пробелов) как "▁" + слово.
+     * @param word Указатель на начало слова.
+     * @param length Длина слова в байтах.
+     * @param tokens Буфер, в конец которого добавляются идентификаторы.
+     */
+    void encode_word(const char *word, size_t length, std::vector<int64_t> &tokens) const;
+
+    /**
+     * @brief Кодирует слово поиском по trie, минуя кэш.
+     */
+    void encode_word_uncached(const char *word, size_t length, std::vector<int64_t> &tokens) const;
 };
@@ -0,0 +1,147 @@
+#include "trie.hpp"
+#include <algorithm>
+
+namespace {
+
+constexpr int32_t kFree = -1;
+constexpr size_t kAlphabet = 256;
+
+} // namespace
+
+void DoubleArrayTrie::build(std::vector<std::pair<std::string, int64_t>> entries) {
+    std::sort(entries.begin(), entries.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    view = nullptr;
+    view_size = 0;
+    units.assign(kAlphabet + 1, Unit{0, kFree, -1});
+    units[0].check = 0;
+
+    std::vector<size_t> next_free(units.size() + 1);
+    for (size_t i = 0; i < next_free.size(); ++i)
+        next_free[i] = i;
+    next_free[0] = 1;
+
+    insert(0, entries, 0, entries.size(), 0, next_free);
+
+    while (!units.empty() && units.back().check == kFree)
+        units.pop_back();
+}
+
+void DoubleArrayTrie::assign(const Unit *data, size_t size) {
+    units.clear();
+    units.shrink_to_fit();
+    view = data;
+    view_size = size;
+}
+
+size_t DoubleArrayTrie::find_free(std::vector<size_t> &next_free, size_t index) {
+    size_t root = index;
+    while (next_free[root] != root)
+        root = next_free[root];
+    while (next_free[index] != root) {
+        size_t next = next_free[index];
+        next_free[index] = root;
+        index = next;
+    }
+    return root;
+}
+
+void DoubleArrayTrie::insert(int32_t node,
+                             const std::vector<std::pair<std::string, int64_t>> &entries,
+                             size_t begin, size_t end, size_t depth,
+                             std::vector<size_t> &next_free) {
+    if (begin < end && entries[begin].first.size() == depth) {
+        units[node].value = static_cast<int32_t>(entries[begin].second);
+        ++begin;
+    }
+    if (begin == end)
+        return;
+
+    std::vector<std::pair<uint8_t, size_t>> children;
+    for (size_t i = begin; i < end; ++i) {
+        uint8_t label = static_cast<uint8_t>(entries[i].first[depth]);
+        if (children.empty() || children.back().first != label)
+            children.emplace_back(label, i);
+    }
+
+    size_t first_label = children.front().first + 1;
+    size_t base = 0;
+    for (size_t cell = find_free(next_free, first_label);; cell = find_free(next_free, cell + 1)) {
+        base = cell - first_label;
+        if (units.size() < base + kAlphabet + 1) {
+            size_t old_size = units.size();
+            units.resize(base + kAlphabet + 1, Unit{0, kFree, -1});
+            next_free.resize(units.size() + 1);
+            for (size_t i = old_size + 1; i < next_free.size(); ++i)
+                next_free[i] = i;
+        }
+
+        bool fits = std::all_of(children.begin(), children.end(), [&](const auto &child) {
+            return units[base + child.first + 1].check == kFree;
+        });
+        if (fits)
+            break;
+    }
+
+    units[node].base = static_cast<int32_t>(base);
+    for (const auto &child : children) {
+        size_t index = base + child.first + 1;
+        units[index].check = node;
+        next_free[index] = index + 1;
+    }
+
+    for (size_t c = 0; c < children.size(); ++c) {
+        size_t child_end = c + 1 < children.size() ? children[c + 1].second : end;
+        int32_t child = static_cast<int32_t>(base + children[c].first + 1);
+        insert(child, entries, children[c].second, child_end, depth + 1, next_free);
+    }
+}
+
+int64_t DoubleArrayTrie::longest_match(size_t node, const char *text, size_t length,
+                                       size_t &match_length) const {
+    int64_t best = -1;
+    const Unit *cells = data();
+    size_t count = size();
+    if (node >= count)
+        return best;
+
+    if (cells[node].value >= 0) {
+        best = cells[node].value;
+        match_length = 0;
+    }
+
+    for (size_t i = 0; i < length; ++i) {
+        size_t next = cells[node].base + static_cast<uint8_t>(text[i]) + 1;
+        if (next >= count || cells[next].check != static_cast<int32_t>(node))
+            break;
+
+        node = next;
+        if (cells[node].value >= 0) {
+            best = cells[node].value;
+            match_length = i + 1;
+        }
+    }
+    return best;
+}
+
+int64_t DoubleArrayTrie::find_node(const char *key, size_t length) const {
+    const Unit *cells = data();
+    size_t count = size();
+    if (count == 0)
+        return -1;
+
+    size_t node = 0;
+    for (size_t i = 0; i < length; ++i) {
+        size_t next = cells[node].base + static_cast<uint8_t>(key[i]) + 1;
+        if (next >= count || cells[next].check != static_cast<int32_t>(node))
+            return -1;
+        node = next;
+    }
+    return static_cast<int64_t>(node);
+}
+
+int64_t DoubleArrayTrie::exact_match(const char *key, size_t length) const {
+    int64_t node = find_node(key, length);
+    return node < 0 ? -1 : data()[node].value;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Двойной массив (double-array trie) для поиска токенов по байтам UTF-8.
+ *
+ * Строится один раз из словаря и позволяет за один проход вперёд по тексту
+ * найти самый длинный токен, начинающийся с текущей позиции, без выделения
+ * памяти и без построения подстрок.
+ */
+class DoubleArrayTrie {
+public:
+    /**
+     * @brief Ячейка двойного массива.
+     */
+    struct Unit {
+        int32_t base;  ///< Смещение дочерних переходов узла.
+        int32_t check; ///< Индекс родительского узла (-1 для свободной ячейки).
+        int32_t value; ///< Идентификатор токена, оканчивающегося в узле (-1, если его нет).
+    };
+
+    /**
+     * @brief Строит trie по набору пар {токен, идентификатор}.
+     * @param entries Токены словаря с их идентификаторами.
+     *
+     * Пример:
+     *   DoubleArrayTrie trie;
+     *   trie.build({{"▁hello", 1}, {"▁he", 2}});
+     */
+    void build(std::vector<std::pair<std::string, int64_t>> entries);
+
+    /**
+     * @brief Ищет самый длинный токен, являющийся префиксом текста.
+     * @param text Указатель на начало текста.
+     * @param length Длина текста в байтах.
+     * @param match_length Длина найденного токена в байтах (заполняется при успехе).
+     * @return Идентификатор токена или -1, если ни один токен не подходит.
+     */
+    int64_t longest_match(const char *text, size_t length, size_t &match_length) const {
+        return longest_match(0, text, length, match_length);
+    }
+
+    /**
+     * @brief Продолжает поиск самого длинного совпадения из заданного узла.
+     * @param node Узел, с которого начинается обход (см. find_node).
+     * @param text Указатель на продолжение ключа.
+     * @param length Длина продолжения в байтах.
+     * @param match_length Число байт text, вошедших в найденный токен
+     *        (0, если токеном является сам ключ узла).
+     * @return Идентификатор токена или -1.
+     *
+     * Позволяет сопоставлять ключ, разбитый на части (например, "▁" + слово),
+     * не склеивая его в отдельную строку.
+     */
+    int64_t longest_match(size_t node, const char *text, size_t length,
+                          size_t &match_length) const;
+
+    /**
+     * @brief Возвращает узел, в который ведёт ключ из корня.
+     * @param key Указатель на начало ключа.
+     * @param length Длина ключа в байтах.
+     * @return Индекс узла или -1, если такого пути в trie нет.
+     */
+    int64_t find_node(const char *key, size_t length) const;
+
+    /**
+     * @brief Ищет токен, полностью совпадающий с ключом.
+     * @param key Указатель на начало ключа.
+     * @param length Длина ключа в байтах.
+     * @return Идентификатор токена или -1, если токена нет в словаре.
+     */
+    int64_t exact_match(const char *key, size_t length) const;
+
+    /**
+     * @brief Подключает готовый двойной массив из внешней памяти без копирования.
+     * @param data Указатель на ячейки (например, в отображённом в память файле).
+     * @param size Количество ячеек.
+     *
+     * Память должна оставаться доступной всё время использования trie.
+     */
+    void assign(const Unit *data, size_t size);
+
+    /**
+     * @brief Возвращает указатель на ячейки двойного массива.
+     */
+    const Unit *data() const { return view ? view : units.data(); }
+
+    /**
+     * @brief Возвращает количество ячеек двойного массива.
+     */
+    size_t size() const { return view ? view_size : units.size(); }
+
+private:
+    std::vector<Unit> units;     ///< Собственные ячейки, корень в нулевой ячейке.
+    const Unit *view = nullptr;  ///< Внешние ячейки, если trie подключён через assign.
+    size_t view_size = 0;        ///< Количество внешних ячеек.
+
+    /**
+     * @brief Рекурсивно размещает потомков узла для ключей [begin, end) на глубине depth.
+     */
+    void insert(int32_t node, const std::vector<std::pair<std::string, int64_t>> &entries,
+                size_t begin, size_t end, size_t depth, std::vector<size_t> &next_free);
+
+    /**
+     * @brief Находит первую свободную ячейку с индексом не меньше index.
+     *
+     * next_free хранит для каждой занятой ячейки ссылку на следующую (система
+     * непересекающихся множеств со сжатием путей), поэтому занятые участки
+     * массива пропускаются без линейного перебора.
+     */
+    static size_t find_free(std::vector<size_t> &next_free, size_t index);
+};
@@ -0,0 +1,264 @@
+#include "vocab_file.hpp"
+#include "perfect_hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+constexpr uint64_t kSectionAlignment = 8;
+
+uint64_t align_up(uint64_t value) {
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+// Проверяет, что секция [offset, offset + bytes) лежит в файле; сумма не вычисляется,
+// чтобы заголовок с огромными значениями не прошёл проверку из-за переполнения.
+bool section_fits(uint64_t offset, uint64_t bytes, size_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+void write_padding(std::ofstream &file, uint64_t from, uint64_t to) {
+    static const char zeros[kSectionAlignment] = {};
+    file.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+template <typename T>
+void write_array(std::ofstream &file, const char *type, const char *name, const T *data,
+                 size_t size) {
+    file << "constexpr " << type << " " << name << "[] = {";
+    for (size_t i = 0; i < size; ++i) {
+        if (i % 16 == 0)
+            file << "\n   ";
+        if constexpr (std::is_same_v<T, char>) {
+            static const char digits[] = "0123456789abcdef";
+            unsigned char byte = static_cast<unsigned char>(data[i]);
+            file << " '\\x" << digits[byte >> 4] << digits[byte & 15] << "',";
+        } else {
+            file << " " << +data[i] << ",";
+        }
+    }
+    if (size == 0)
+        file << "0";
+    file << "\n};\n\n";
+}
+
+} // namespace
+
+std::shared_ptr<const MappedFile> map_vocab_file(const std::string &path) {
+    try {
+        return std::make_shared<const MappedFile>(path);
+    } catch (const std::runtime_error &) {
+        throw std::runtime_error("Failed to open vocab file: " + path);
+    }
+}
+
+std::vector<std::pair<std::string, int64_t>> read_json_vocab(const char *data, size_t size) {
+    nlohmann::json j = nlohmann::json::parse(data, data + size);
+
+    std::vector<std::pair<std::string, int64_t>> entries;
+    entries.reserve(j.size());
+    for (auto &[token, id] : j.items()) {
+        entries.emplace_back(token, id.get<int64_t>());
+    }
+    return entries;
+}
+
+std::vector<std::pair<std::string, int64_t>> read_json_vocab(const std::string &path) {
+    std::shared_ptr<const MappedFile> file = map_vocab_file(path);
+    return read_json_vocab(file->data(), file->size());
+}
+
+TokenTable build_token_table(const std::vector<std::pair<std::string, int64_t>> &entries) {
+    int64_t max_id = -1;
+    for (const auto &[token, id] : entries) {
+        if (id < 0)
+            throw std::runtime_error("Negative token id in vocab: " + token);
+        max_id = std::max(max_id, id);
+    }
+
+    size_t token_count = static_cast<size_t>(max_id + 1);
+    std::vector<const std::string *> tokens(token_count, nullptr);
+    size_t pool_size = 0;
+    for (const auto &[token, id] : entries) {
+        tokens[id] = &token;
+        pool_size += token.size();
+    }
+
+    TokenTable table;
+    table.pool.reserve(pool_size);
+    table.offsets.reserve(token_count + 1);
+    table.flags.reserve(token_count);
+    for (const std::string *token : tokens) {
+        table.offsets.push_back(static_cast<uint32_t>(table.pool.size()));
+        if (!token) {
+            table.flags.push_back(kTokenMissing);
+            continue;
+        }
+
+        uint8_t flags = 0;
+        if (*token == "<pad>" || *token == "<s>" || *token == "</s>")
+            flags |= kTokenSpecial;
+        if (token->compare(0, kWordStartPrefixLength, "▁") == 0)
+            flags |= kTokenWordStart;
+        table.flags.push_back(flags);
+        table.pool += *token;
+    }
+    table.offsets.push_back(static_cast<uint32_t>(table.pool.size()));
+    return table;
+}
+
+VocabView view_token_table(const TokenTable &table) {
+    VocabView view;
+    view.offsets = table.offsets.data();
+    view.flags = table.flags.data();
+    view.pool = table.pool.data();
+    view.token_count = table.flags.size();
+    return view;
+}
+
+bool is_binary_vocab(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(kBinaryVocabMagic)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) &&
+           std::memcmp(magic, kBinaryVocabMagic, sizeof(magic)) == 0;
+}
+
+bool is_binary_vocab(const char *data, size_t size) {
+    return size >= sizeof(kBinaryVocabMagic) &&
+           std::memcmp(data, kBinaryVocabMagic, sizeof(kBinaryVocabMagic)) == 0;
+}
+
+VocabView view_binary_vocab(const char *data, size_t size) {
+    BinaryVocabHeader header;
+    if (size < sizeof(header))
+        throw std::runtime_error("Binary vocab is truncated");
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, kBinaryVocabMagic, sizeof(header.magic)) != 0)
+        throw std::runtime_error("Binary vocab has invalid signature");
+    if (header.version != kBinaryVocabVersion)
+        throw std::runtime_error("Unsupported binary vocab version: " +
+                                 std::to_string(header.version));
+
+    uint64_t offsets_bytes = (uint64_t(header.token_count) + 1) * sizeof(uint32_t);
+    if (header.offsets_offset % alignof(uint32_t) != 0 ||
+        header.trie_offset % alignof(DoubleArrayTrie::Unit) != 0 ||
+        header.trie_size > size / sizeof(DoubleArrayTrie::Unit) ||
+        !section_fits(header.offsets_offset, offsets_bytes, size) ||
+        !section_fits(header.flags_offset, header.token_count, size) ||
+        !section_fits(header.pool_offset, header.pool_size, size) ||
+        !section_fits(header.trie_offset, header.trie_size * sizeof(DoubleArrayTrie::Unit), size))
+        throw std::runtime_error("Binary vocab has invalid section bounds");
+
+    VocabView view;
+    view.offsets = reinterpret_cast<const uint32_t *>(data + header.offsets_offset);
+    view.flags = reinterpret_cast<const uint8_t *>(data + header.flags_offset);
+    view.pool = data + header.pool_offset;
+    view.token_count = header.token_count;
+    view.trie = reinterpret_cast<const DoubleArrayTrie::Unit *>(data + header.trie_offset);
+    view.trie_size = header.trie_size;
+
+    // Токены читаются без проверок, поэтому смещения проверяются один раз здесь:
+    // неубывающие и в пределах пула.
+    for (uint32_t id = 0; id < view.token_count; ++id)
+        if (view.offsets[id] > view.offsets[id + 1])
+            throw std::runtime_error("Binary vocab has invalid token offsets");
+    if (view.offsets[view.token_count] > header.pool_size)
+        throw std::runtime_error("Binary vocab has invalid token offsets");
+    return view;
+}
+
+void compile_vocab(const std::string &json_path, const std::string &binary_path) {
+    std::vector<std::pair<std::string, int64_t>> entries = read_json_vocab(json_path);
+    TokenTable table = build_token_table(entries);
+
+    DoubleArrayTrie trie;
+    trie.build(std::move(entries));
+
+    uint64_t offsets_bytes = table.offsets.size() * sizeof(uint32_t);
+
+    BinaryVocabHeader header{};
+    std::memcpy(header.magic, kBinaryVocabMagic, sizeof(header.magic));
+    header.version = kBinaryVocabVersion;
+    header.token_count = static_cast<uint32_t>(table.flags.size());
+    header.offsets_offset = align_up(sizeof(header));
+    header.flags_offset = align_up(header.offsets_offset + offsets_bytes);
+    header.pool_offset = align_up(header.flags_offset + table.flags.size());
+    header.pool_size = table.pool.size();
+    header.trie_offset = align_up(header.pool_offset + table.pool.size());
+    header.trie_size = trie.size();
+
+    std::ofstream file(binary_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to create binary vocab file: " + binary_path);
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write_padding(file, sizeof(header), header.offsets_offset);
+    file.write(reinterpret_cast<const char *>(table.offsets.data()),
+               static_cast<std::streamsize>(offsets_bytes));
+    write_padding(file, header.offsets_offset + offsets_bytes, header.flags_offset);
+    file.write(reinterpret_cast<const char *>(table.flags.data()),
+               static_cast<std::streamsize>(table.flags.size()));
+    write_padding(file, header.flags_offset + table.flags.size(), header.pool_offset);
+    file.write(table.pool.data(), static_cast<std::streamsize>(table.pool.size()));
+    write_padding(file, header.pool_offset + table.pool.size(), header.trie_offset);
+    file.write(reinterpret_cast<const char *>(trie.data()),
+               static_cast<std::streamsize>(trie.size() * sizeof(DoubleArrayTrie::Unit)));
+
+    if (!file) {
+        throw std::runtime_error("Failed to write binary vocab file: " + binary_path);
+    }
+}
+
+void write_embedded_vocab_source(const std::string &json_path, const std::string &source_path) {
+    std::vector<std::pair<std::string, int64_t>> entries = read_json_vocab(json_path);
+    TokenTable table = build_token_table(entries);
+    PerfectHash hash = build_perfect_hash(entries);
+
+    DoubleArrayTrie trie;
+    trie.build(std::move(entries));
+
+    std::ofstream file(source_path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to create embedded vocab source: " + source_path);
+    }
+
+    file << "// Generated by vocab_compiler --emit-cpp from " << json_path << ". Do not edit.\n"
+         << "#include \"embedded_vocab.hpp\"\n\n"
+         << "namespace {\n\n";
+
+    write_array(file, "uint32_t", "kOffsets", table.offsets.data(), table.offsets.size());
+    write_array(file, "uint8_t", "kFlags", table.flags.data(), table.flags.size());
+    write_array(file, "char", "kPool", table.pool.data(), table.pool.size());
+    write_array(file, "uint32_t", "kHashSeeds", hash.seeds.data(), hash.seeds.size());
+    write_array(file, "int32_t", "kHashSlots", hash.slots.data(), hash.slots.size());
+
+    file << "constexpr DoubleArrayTrie::Unit kTrie[] = {";
+    for (size_t i = 0; i < trie.size(); ++i) {
+        const DoubleArrayTrie::Unit &unit = trie.data()[i];
+        if (i % 4 == 0)
+            file << "\n   ";
+        file << " {" << unit.base << ", " << unit.check << ", " << unit.value << "},";
+    }
+    file << "\n};\n\n"
+         << "constexpr EmbeddedVocab kVocab = {\n"
+         << "    kOffsets, kFlags, kPool, " << table.flags.size() << ",\n"
+         << "    kTrie, " << trie.size() << ",\n"
+         << "    kHashSeeds, " << hash.seeds.size() << ",\n"
+         << "    kHashSlots, " << hash.slots.size() << ",\n"
+         << "};\n\n"
+         << "} // namespace\n\n"
+         << "const EmbeddedVocab &embedded_vocab() {\n"
+         << "    return kVocab;\n"
+         << "}\n";
+
+    if (!file) {
+        throw std::runtime_error("Failed to write embedded vocab source: " + source_path);
+    }
+}
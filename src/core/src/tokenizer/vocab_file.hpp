@@ -0,0 +1,163 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "trie.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Сигнатура бинарного словаря.
+ */
+constexpr char kBinaryVocabMagic[8] = {'S', 'P', 'M', 'V', 'O', 'C', 'A', 'B'};
+
+/**
+ * @brief Версия формата бинарного словаря.
+ */
+constexpr uint32_t kBinaryVocabVersion = 2;
+
+/**
+ * @brief Признаки токена, вычисляемые один раз при построении словаря.
+ */
+enum TokenFlags : uint8_t {
+    kTokenMissing = 1 << 0,   ///< Идентификатору не соответствует ни один токен.
+    kTokenWordStart = 1 << 1, ///< Токен начинается с "▁" (начало слова).
+    kTokenSpecial = 1 << 2,   ///< Служебный токен (<pad>, <s>, </s>), пропускается при декодировании.
+};
+
+/**
+ * @brief Длина префикса "▁" в байтах UTF-8.
+ */
+constexpr size_t kWordStartPrefixLength = 3;
+
+/**
+ * @brief Заголовок бинарного словаря.
+ *
+ * Файл состоит из заголовка и четырёх секций, выровненных по 8 байт:
+ * таблицы смещений (token_count + 1 значений uint32_t), признаков токенов
+ * (token_count значений TokenFlags), пула строк токенов и ячеек двойного массива
+ * DoubleArrayTrie. Токен с идентификатором id занимает байты
+ * [offsets[id], offsets[id + 1]) пула. Числа хранятся в порядке байт платформы.
+ */
+struct BinaryVocabHeader {
+    char magic[8];           ///< Сигнатура kBinaryVocabMagic.
+    uint32_t version;        ///< Версия формата.
+    uint32_t token_count;    ///< Количество идентификаторов (максимальный id + 1).
+    uint64_t offsets_offset; ///< Смещение таблицы смещений от начала файла.
+    uint64_t flags_offset;   ///< Смещение таблицы признаков от начала файла.
+    uint64_t pool_offset;    ///< Смещение пула строк от начала файла.
+    uint64_t pool_size;      ///< Размер пула строк в байтах.
+    uint64_t trie_offset;    ///< Смещение ячеек trie от начала файла.
+    uint64_t trie_size;      ///< Количество ячеек trie.
+};
+
+/**
+ * @brief Плотная таблица токенов: все строки лежат в одном пуле.
+ */
+struct TokenTable {
+    std::string pool;              ///< Пул строк токенов, идущих подряд по возрастанию id.
+    std::vector<uint32_t> offsets; ///< Смещения токенов в пуле (token_count + 1 значений).
+    std::vector<uint8_t> flags;    ///< Признаки токенов (TokenFlags).
+};
+
+/**
+ * @brief Представление таблиц словаря поверх памяти без копирования.
+ *
+ * Указывает либо в отображённый бинарный файл, либо в TokenTable,
+ * построенную из JSON.
+ */
+struct VocabView {
+    const uint32_t *offsets = nullptr;               ///< Таблица смещений токенов в пуле.
+    const uint8_t *flags = nullptr;                  ///< Признаки токенов (TokenFlags).
+    const char *pool = nullptr;                      ///< Пул строк токенов.
+    size_t token_count = 0;                          ///< Количество идентификаторов.
+    const DoubleArrayTrie::Unit *trie = nullptr;     ///< Ячейки двойного массива.
+    size_t trie_size = 0;                            ///< Количество ячеек двойного массива.
+};
+
+/**
+ * @brief Строит плотную таблицу токенов с признаками.
+ * @param entries Пары {токен, идентификатор}.
+ * @return Таблица, индексируемая идентификатором токена.
+ * @throws std::runtime_error Если в словаре есть отрицательный идентификатор.
+ */
+TokenTable build_token_table(const std::vector<std::pair<std::string, int64_t>> &entries);
+
+/**
+ * @brief Возвращает представление таблицы токенов (без trie).
+ * @param table Таблица токенов; должна жить дольше представления.
+ */
+VocabView view_token_table(const TokenTable &table);
+
+/**
+ * @brief Читает словарь в формате JSON ({"токен": id, ...}).
+ * @param path Путь к JSON-файлу.
+ * @return Пары {токен, идентификатор}.
+ * @throws std::runtime_error Если файл не удалось открыть.
+ *
+ * Файл отображается в память и разбирается вариантом для данных в памяти.
+ */
+std::vector<std::pair<std::string, int64_t>> read_json_vocab(const std::string &path);
+
+/**
+ * @brief Отображает файл словаря в память.
+ * @param path Путь к vocab.json или бинарному словарю.
+ * @throws std::runtime_error Если файл не удалось открыть.
+ */
+std::shared_ptr<const MappedFile> map_vocab_file(const std::string &path);
+
+/**
+ * @brief Разбирает словарь в формате JSON из памяти.
+ * @param data Указатель на текст JSON.
+ * @param size Размер текста в байтах.
+ * @return Пары {токен, идентификатор}.
+ */
+std::vector<std::pair<std::string, int64_t>> read_json_vocab(const char *data, size_t size);
+
+/**
+ * @brief Проверяет, начинается ли файл с сигнатуры бинарного словаря.
+ * @param path Путь к файлу.
+ * @return true, если файл является бинарным словарём.
+ */
+bool is_binary_vocab(const std::string &path);
+
+/**
+ * @brief Проверяет, начинаются ли данные с сигнатуры бинарного словаря.
+ * @param data Указатель на начало файла.
+ * @param size Размер файла в байтах.
+ */
+bool is_binary_vocab(const char *data, size_t size);
+
+/**
+ * @brief Проверяет бинарный словарь в памяти и возвращает его представление.
+ * @param data Указатель на начало файла.
+ * @param size Размер файла в байтах.
+ * @return Представление словаря, ссылающееся на переданную память.
+ * @throws std::runtime_error Если заголовок или границы секций некорректны.
+ */
+VocabView view_binary_vocab(const char *data, size_t size);
+
+/**
+ * @brief Компилирует JSON-словарь в бинарный формат.
+ * @param json_path Путь к исходному vocab.json.
+ * @param binary_path Путь к создаваемому бинарному файлу.
+ * @throws std::runtime_error Если файлы не удалось прочитать или записать.
+ *
+ * Пример:
+ *   compile_vocab("opus-mt-en-ru/vocab.json", "opus-mt-en-ru/vocab.bin");
+ */
+void compile_vocab(const std::string &json_path, const std::string &binary_path);
+
+/**
+ * @brief Генерирует исходник C++ со словарём для сборки без чтения файлов.
+ * @param json_path Путь к исходному vocab.json.
+ * @param source_path Путь к создаваемому .cpp (см. embedded_vocab.hpp).
+ * @throws std::runtime_error Если файлы не удалось прочитать или записать.
+ *
+ * Пример:
+ *   write_embedded_vocab_source("opus-mt-en-ru/vocab.json", "embedded_vocab.cpp");
+ */
+void write_embedded_vocab_source(const std::string &json_path, const std::string &source_path);
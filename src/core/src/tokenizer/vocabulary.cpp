@@ -0,0 +1,55 @@
+#include "vocabulary.hpp"
+#include "vocabulary_registry.hpp"
+#include <stdexcept>
+#include <utility>
+
+Vocabulary::Vocabulary(const std::string &vocab_path) : Vocabulary(map_vocab_file(vocab_path)) {}
+
+Vocabulary::Vocabulary(std::shared_ptr<const MappedFile> file) {
+    if (is_binary_vocab(file->data(), file->size())) {
+        tables = view_binary_vocab(file->data(), file->size());
+        trie.assign(tables.trie, tables.trie_size);
+        mapped = std::move(file);
+    } else {
+        std::vector<std::pair<std::string, int64_t>> entries =
+            read_json_vocab(file->data(), file->size());
+        table = build_token_table(entries);
+        tables = view_token_table(table);
+        trie.build(std::move(entries));
+    }
+
+    unk = find("<unk>");
+    word_start_node = trie.find_node("▁", kWordStartPrefixLength);
+}
+
+Vocabulary::Vocabulary(const EmbeddedVocab &data) {
+    tables.offsets = data.offsets;
+    tables.flags = data.flags;
+    tables.pool = data.pool;
+    tables.token_count = data.token_count;
+    tables.trie = data.trie;
+    tables.trie_size = data.trie_size;
+    trie.assign(data.trie, data.trie_size);
+
+    hash_seeds = data.hash_seeds;
+    hash_bucket_count = data.bucket_count;
+    hash_slots = data.hash_slots;
+    hash_slot_count = data.slot_count;
+
+    unk = find("<unk>");
+    word_start_node = trie.find_node("▁", kWordStartPrefixLength);
+}
+
+std::shared_ptr<const Vocabulary> Vocabulary::embedded() {
+#ifdef TOKENIZER_EMBEDDED_VOCAB
+    static const std::shared_ptr<const Vocabulary> vocabulary =
+        std::make_shared<const Vocabulary>(embedded_vocab());
+    return vocabulary;
+#else
+    throw std::runtime_error("Tokenizer was built without an embedded vocabulary");
+#endif
+}
+
+std::shared_ptr<const Vocabulary> Vocabulary::load(const std::string &vocab_path) {
+    return VocabularyRegistry::instance().load(vocab_path);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "embedded_vocab.hpp"
+#include "mapped_file.hpp"
+#include "perfect_hash.hpp"
+#include "trie.hpp"
+#include "vocab_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Неизменяемый словарь токенизатора.
+ *
+ * Содержит таблицу токенов и trie для кодирования. После создания не меняется,
+ * поэтому один экземпляр безопасно разделяется (через std::shared_ptr) между
+ * любым количеством объектов Tokenizer и Translator и между потоками.
+ */
+class Vocabulary {
+public:
+    /**
+     * @brief Загружает словарь из JSON-файла или бинарного словаря.
+     * @param vocab_path Путь к vocab.json или к файлу, собранному vocab_compiler.
+     * @throws std::runtime_error Если файл не удалось открыть или прочитать.
+     */
+    explicit Vocabulary(const std::string &vocab_path);
+
+    /**
+     * @brief Загружает словарь из уже отображённого файла.
+     * @param file Отображение vocab.json или бинарного словаря. Бинарный словарь
+     *        ссылается на отображение и продлевает его жизнь; JSON разбирается,
+     *        и отображение не сохраняется.
+     * @throws std::runtime_error Если содержимое не удалось разобрать.
+     */
+    explicit Vocabulary(std::shared_ptr<const MappedFile> file);
+
+    /**
+     * @brief Использует таблицы, вкомпилированные в программу, без копирования.
+     * @param data Таблицы словаря; должны жить дольше объекта.
+     */
+    explicit Vocabulary(const EmbeddedVocab &data);
+
+    Vocabulary(const Vocabulary &) = delete;
+    Vocabulary &operator=(const Vocabulary &) = delete;
+
+    /**
+     * @brief Загружает словарь и возвращает разделяемый указатель на него.
+     * @param vocab_path Путь к словарю.
+     *
+     * Загрузка идёт через VocabularyRegistry: если словарь с таким же
+     * содержимым уже загружен, возвращается он.
+     *
+     * Пример:
+     *   auto vocab = Vocabulary::load("vocab.json");
+     *   Tokenizer a(vocab), b(vocab); // словарь в памяти один
+     */
+    static std::shared_ptr<const Vocabulary> load(const std::string &vocab_path);
+
+    /**
+     * @brief Возвращает словарь, вкомпилированный в библиотеку опцией TOKENIZER_EMBED_VOCAB.
+     * @throws std::runtime_error Если библиотека собрана без встроенного словаря.
+     *
+     * Пример:
+     *   Tokenizer tokenizer(Vocabulary::embedded()); // без чтения файлов
+     */
+    static std::shared_ptr<const Vocabulary> embedded();
+
+    /**
+     * @brief Ищет самый длинный токен, являющийся префиксом текста.
+     * @param text Указатель на начало текста.
+     * @param length Длина текста в байтах.
+     * @param match_length Длина найденного токена в байтах.
+     * @return Идентификатор токена или -1.
+     */
+    int64_t longest_match(const char *text, size_t length, size_t &match_length) const {
+        return trie.longest_match(text, length, match_length);
+    }
+
+    /**
+     * @brief Ищет самый длинный токен вида "▁" + префикс text без склейки строк.
+     * @param text Указатель на начало слова.
+     * @param length Длина слова в байтах.
+     * @param match_length Число байт слова, вошедших в токен (0, если токен — сам "▁").
+     * @return Идентификатор токена или -1.
+     */
+    int64_t longest_word_start_match(const char *text, size_t length, size_t &match_length) const {
+        if (word_start_node < 0)
+            return -1;
+        return trie.longest_match(static_cast<size_t>(word_start_node), text, length, match_length);
+    }
+
+    /**
+     * @brief Возвращает идентификатор токена или -1, если его нет в словаре.
+     *
+     * Для встроенного словаря используется совершенная хеш-функция: одно
+     * обращение к таблице и сверка строки.
+     */
+    int64_t find(std::string_view token) const {
+        if (hash_slot_count == 0)
+            return trie.exact_match(token.data(), token.size());
+
+        int64_t id = perfect_hash_candidate(hash_seeds, hash_bucket_count, hash_slots,
+                                            hash_slot_count, token.data(), token.size());
+        return id >= 0 && this->token(id) == token ? id : -1;
+    }
+
+    /**
+     * @brief Возвращает текст токена или пустую строку, если идентификатора нет.
+     */
+    std::string_view token(int64_t id) const {
+        if (id < 0 || static_cast<size_t>(id) >= tables.token_count)
+            return {};
+        uint32_t begin = tables.offsets[id];
+        return std::string_view(tables.pool + begin, tables.offsets[id + 1] - begin);
+    }
+
+    /**
+     * @brief Возвращает признаки токена (TokenFlags); для неизвестного id — kTokenMissing.
+     */
+    uint8_t flags(int64_t id) const {
+        if (id < 0 || static_cast<size_t>(id) >= tables.token_count)
+            return kTokenMissing;
+        return tables.flags[id];
+    }
+
+    /**
+     * @brief Дописывает декодированный токен в конец текста.
+     * @param id Идентификатор токена.
+     * @param text Текст, к которому добавляется токен.
+     * @return Количество добавленных байт.
+     *
+     * Служебные и неизвестные токены пропускаются; токен с префиксом "▁"
+     * добавляется без префикса и отделяется пробелом, если текст не пуст.
+     */
+    size_t append_token(int64_t id, std::string &text) const {
+        uint8_t token_flags = flags(id);
+        if (token_flags & (kTokenMissing | kTokenSpecial))
+            return 0;
+
+        size_t old_size = text.size();
+        const char *data = tables.pool + tables.offsets[id];
+        size_t length = tables.offsets[id + 1] - tables.offsets[id];
+        if (token_flags & kTokenWordStart) {
+            if (!text.empty())
+                text += ' ';
+            text.append(data + kWordStartPrefixLength, length - kWordStartPrefixLength);
+        } else {
+            text.append(data, length);
+        }
+        return text.size() - old_size;
+    }
+
+    /**
+     * @brief Возвращает количество идентификаторов (максимальный id + 1).
+     */
+    size_t size() const { return tables.token_count; }
+
+    /**
+     * @brief Возвращает идентификатор токена <unk> или -1, если его нет.
+     */
+    int64_t unk_id() const { return unk; }
+
+    /**
+     * @brief Возвращает таблицы словаря для прямого доступа.
+     */
+    const VocabView &view() const { return tables; }
+
+private:
+    std::shared_ptr<const MappedFile> mapped; ///< Отображённый бинарный словарь (если загружен он).
+    TokenTable table;                   ///< Таблица токенов, построенная из JSON.
+    DoubleArrayTrie trie;               ///< Trie для поиска самого длинного совпадения.
+    VocabView tables;                   ///< Таблицы внутри mapped или table.
+    int64_t unk = -1;                   ///< Идентификатор <unk>.
+    int64_t word_start_node = -1;       ///< Узел trie, соответствующий префиксу "▁".
+    const uint32_t *hash_seeds = nullptr; ///< Seed корзин совершенной хеш-функции.
+    size_t hash_bucket_count = 0;         ///< Количество корзин.
+    const int32_t *hash_slots = nullptr;  ///< Ячейки совершенной хеш-функции.
+    size_t hash_slot_count = 0;           ///< Количество ячеек (0 — хеш-функции нет).
+};
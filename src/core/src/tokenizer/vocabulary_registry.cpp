@@ -0,0 +1,115 @@
+#include "vocabulary_registry.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+VocabularyRegistry &VocabularyRegistry::instance() {
+    static VocabularyRegistry registry;
+    return registry;
+}
+
+uint64_t VocabularyRegistry::content_hash(const char *data, size_t size) {
+    constexpr uint64_t kPrime = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * kPrime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * kPrime;
+
+    hash ^= hash >> 32;
+    return hash;
+}
+
+bool VocabularyRegistry::Entry::same_content(const char *data, size_t size) const {
+    return mapped->size() == size && std::memcmp(mapped->data(), data, size) == 0;
+}
+
+void VocabularyRegistry::prune() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        std::vector<std::shared_ptr<Entry>> &bucket = it->second;
+        bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+                                    [](const std::shared_ptr<Entry> &entry) {
+                                        return entry->done && entry->vocabulary.expired();
+                                    }),
+                     bucket.end());
+        it = bucket.empty() ? entries.erase(it) : std::next(it);
+    }
+}
+
+std::shared_ptr<const Vocabulary> VocabularyRegistry::load(const std::string &vocab_path) {
+    std::shared_ptr<const MappedFile> file = map_vocab_file(vocab_path);
+    Key key(content_hash(file->data(), file->size()), file->size());
+
+    for (;;) {
+        std::shared_ptr<Entry> entry;
+        std::shared_future<void> pending;
+        std::promise<void> loaded;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            prune();
+            std::vector<std::shared_ptr<Entry>> &bucket = entries[key];
+            for (const std::shared_ptr<Entry> &candidate : bucket) {
+                if (!candidate->same_content(file->data(), file->size()))
+                    continue;
+                if (auto existing = candidate->vocabulary.lock())
+                    return existing;
+                pending = candidate->loaded;
+                break;
+            }
+
+            if (!pending.valid()) {
+                // Для сравнения хранится отображение, а не копия: его страницы
+                // не изменяются и разделяются с кешем страниц.
+                entry = std::make_shared<Entry>();
+                entry->mapped = file;
+                entry->loaded = loaded.get_future().share();
+                bucket.push_back(entry);
+            }
+        }
+
+        if (pending.valid()) {
+            // Тот же словарь разбирает другой поток: ждём его и ищем снова.
+            pending.get();
+            continue;
+        }
+
+        // Словарь разбирается вне общей блокировки из того же отображения.
+        std::shared_ptr<const Vocabulary> vocabulary;
+        try {
+            vocabulary = std::make_shared<const Vocabulary>(std::move(file));
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::vector<std::shared_ptr<Entry>> &bucket = entries[key];
+                bucket.erase(std::find(bucket.begin(), bucket.end(), entry));
+            }
+            loaded.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry->vocabulary = vocabulary;
+            entry->done = true;
+        }
+        loaded.set_value();
+        return vocabulary;
+    }
+}
+
+size_t VocabularyRegistry::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    prune();
+    size_t count = 0;
+    for (const auto &[key, bucket] : entries)
+        count += bucket.size();
+    return count;
+}
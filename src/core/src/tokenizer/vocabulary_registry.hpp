@@ -0,0 +1,80 @@
+#pragma once
+
+#include "vocabulary.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Реестр загруженных словарей, адресуемых по содержимому.
+ *
+ * Файл словаря отображается в память один раз: по его хешу и размеру ищутся
+ * кандидаты, совпадение подтверждается побайтовым сравнением, а разбирается
+ * словарь из того же отображения. Если словарь с тем же содержимым уже загружен
+ * и ещё используется, возвращается он. Так одинаковые vocab.json разных
+ * направлений перевода (opus-mt-en-ru и opus-mt-ru-en) занимают память один раз.
+ * Разбор идёт вне общей блокировки: разные словари загружаются параллельно, а
+ * одновременные загрузки одного содержимого ждут первую. Реестр хранит слабые
+ * ссылки и не продлевает жизнь словарей.
+ */
+class VocabularyRegistry {
+public:
+    /**
+     * @brief Возвращает общий для процесса реестр.
+     */
+    static VocabularyRegistry &instance();
+
+    /**
+     * @brief Загружает словарь или возвращает уже загруженный с тем же содержимым.
+     * @param vocab_path Путь к vocab.json или бинарному словарю.
+     * @return Разделяемый словарь.
+     * @throws std::runtime_error Если файл не удалось открыть или прочитать.
+     */
+    std::shared_ptr<const Vocabulary> load(const std::string &vocab_path);
+
+    /**
+     * @brief Возвращает количество живых словарей в реестре.
+     */
+    size_t size();
+
+    /**
+     * @brief Вычисляет 64-битный хеш содержимого.
+     * @param data Указатель на данные.
+     * @param size Размер данных в байтах.
+     *
+     * Хеш только выбирает кандидатов; совпадение проверяется сравнением байт.
+     */
+    static uint64_t content_hash(const char *data, size_t size);
+
+private:
+    using Key = std::pair<uint64_t, size_t>; ///< Хеш и размер файла.
+
+    /**
+     * @brief Словарь с известным содержимым.
+     */
+    struct Entry {
+        std::shared_ptr<const MappedFile> mapped;     ///< Отображение файла словаря для сравнения (бинарный держит и словарь).
+        std::shared_future<void> loaded;              ///< Готов, когда разбор завершён.
+        bool done = false;                            ///< Разбор завершён (под mutex).
+        std::weak_ptr<const Vocabulary> vocabulary;   ///< Загруженный словарь (под mutex).
+
+        /**
+         * @brief Проверяет, совпадает ли содержимое с данными.
+         */
+        bool same_content(const char *data, size_t size) const;
+    };
+
+    std::mutex mutex;                                          ///< Защищает entries и поля done/vocabulary.
+    std::map<Key, std::vector<std::shared_ptr<Entry>>> entries; ///< Словари по хешу и размеру.
+
+    /**
+     * @brief Удаляет записи выгруженных словарей (под mutex).
+     */
+    void prune();
+};
@@ -0,0 +1,82 @@
+#include "word_cache.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+WordCache::WordCache(size_t capacity)
+    : shard_count(std::clamp<size_t>(capacity / kEntriesPerShard, 1, kMaxShards)),
+      shards(new Shard[shard_count]), total_capacity(capacity) {
+    if (capacity == 0)
+        throw std::invalid_argument("capacity is zero");
+
+    for (size_t i = 0; i < shard_count; ++i) {
+        Shard &shard = shards[i];
+        shard.capacity = capacity / shard_count + (i < capacity % shard_count ? 1 : 0);
+        shard.entries.reserve(shard.capacity);
+        shard.index.reserve(shard.capacity);
+    }
+}
+
+WordCache::Shard &WordCache::shard_for(std::string_view word) const {
+    return shards[std::hash<std::string_view>()(word) % shard_count];
+}
+
+bool WordCache::lookup(std::string_view word, std::vector<int64_t> &tokens) {
+    if (word.size() <= kMaxWordLength) {
+        Shard &shard = shard_for(word);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(word);
+        if (it != shard.index.end()) {
+            Entry &entry = shard.entries[it->second];
+            entry.referenced = true;
+            tokens.insert(tokens.end(), entry.ids.begin(), entry.ids.end());
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void WordCache::insert(std::string_view word, const int64_t *ids, size_t count) {
+    if (word.size() > kMaxWordLength)
+        return;
+
+    Shard &shard = shard_for(word);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.index.count(word))
+        return;
+
+    size_t slot;
+    if (shard.entries.size() < shard.capacity) {
+        slot = shard.entries.size();
+        shard.entries.emplace_back();
+    } else {
+        while (shard.entries[shard.hand].referenced) {
+            shard.entries[shard.hand].referenced = false;
+            shard.hand = (shard.hand + 1) % shard.capacity;
+        }
+        slot = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.capacity;
+        shard.index.erase(shard.entries[slot].word);
+    }
+
+    Entry &entry = shard.entries[slot];
+    entry.word.assign(word.data(), word.size());
+    entry.ids.assign(ids, ids + count);
+    entry.referenced = false;
+    shard.index.emplace(entry.word, slot);
+}
+
+WordCache::Stats WordCache::stats() const {
+    Stats result;
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < shard_count; ++i) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        result.size += shards[i].entries.size();
+    }
+    return result;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Ограниченный кэш "слово → идентификаторы токенов" для Tokenizer.
+ *
+ * Кэш разбит на сегменты со своими мьютексами, поэтому его можно использовать
+ * из нескольких потоков одновременно. Внутри сегмента записи вытесняются по
+ * алгоритму CLOCK: при обращении запись помечается, а стрелка при вставке
+ * пропускает помеченные записи, снимая с них пометку. Попадание в кэш не
+ * выделяет память.
+ */
+class WordCache {
+public:
+    /**
+     * @brief Статистика обращений к кэшу.
+     */
+    struct Stats {
+        uint64_t hits = 0;   ///< Число попаданий.
+        uint64_t misses = 0; ///< Число промахов.
+        size_t size = 0;     ///< Текущее количество записей.
+    };
+
+    /**
+     * @brief Создаёт кэш заданной ёмкости.
+     * @param capacity Максимальное количество слов в кэше.
+     * @throws std::invalid_argument Если capacity равна нулю.
+     */
+    explicit WordCache(size_t capacity);
+
+    /**
+     * @brief Ищет слово и при попадании дописывает его токены в конец tokens.
+     * @param word Слово без пробелов.
+     * @param tokens Буфер, в который добавляются идентификаторы.
+     * @return true при попадании.
+     */
+    bool lookup(std::string_view word, std::vector<int64_t> &tokens);
+
+    /**
+     * @brief Сохраняет разбиение слова на токены.
+     * @param word Слово без пробелов.
+     * @param ids Указатель на идентификаторы токенов слова.
+     * @param count Количество идентификаторов.
+     */
+    void insert(std::string_view word, const int64_t *ids, size_t count);
+
+    /**
+     * @brief Возвращает статистику обращений.
+     */
+    Stats stats() const;
+
+    /**
+     * @brief Возвращает ёмкость кэша.
+     */
+    size_t capacity() const { return total_capacity; }
+
+    /**
+     * @brief Максимальная длина кэшируемого слова в байтах.
+     */
+    static constexpr size_t kMaxWordLength = 64;
+
+private:
+    struct Entry {
+        std::string word;         ///< Слово (ключ индекса ссылается на эту строку).
+        std::vector<int64_t> ids; ///< Разбиение слова на токены.
+        bool referenced = false;  ///< Бит обращения для алгоритма CLOCK.
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;                          ///< Записи, не больше capacity.
+        std::unordered_map<std::string_view, size_t> index;  ///< Слово → номер записи.
+        size_t capacity = 0;                                 ///< Ёмкость сегмента.
+        size_t hand = 0;                                     ///< Стрелка CLOCK.
+    };
+
+    static constexpr size_t kMaxShards = 16;         ///< Максимальное число сегментов.
+    static constexpr size_t kEntriesPerShard = 1024; ///< Ёмкость, на которую заводится сегмент.
+
+    size_t shard_count;              ///< Число сегментов.
+    std::unique_ptr<Shard[]> shards; ///< Сегменты кэша.
+    size_t total_capacity;           ///< Суммарная ёмкость.
+    std::atomic<uint64_t> hits{0};   ///< Счётчик попаданий.
+    std::atomic<uint64_t> misses{0}; ///< Счётчик промахов.
+
+    Shard &shard_for(std::string_view word) const;
+};
@@ -0,0 +1,144 @@
+#include "batch_scheduler.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+BatchScheduler::BatchScheduler(std::shared_ptr<const Translator> translator,
+                               const BatchSchedulerOptions &options)
+    : translator(std::move(translator)), options(options) {
+    if (!this->translator)
+        throw std::invalid_argument("BatchScheduler requires a translator");
+    if (options.max_batch_size == 0 || options.max_queue_depth == 0)
+        throw std::invalid_argument("BatchScheduler batch size and queue depth must be positive");
+
+    counters.max_batch_size = options.max_batch_size;
+
+    // Пакеты разных потоков переводятся параллельно на разных репликах сессий.
+    size_t count = options.workers ? options.workers
+                                   : this->translator->session_pool_stats().replicas;
+    for (size_t i = 0; i < std::max<size_t>(count, 1); ++i)
+        workers.emplace_back(&BatchScheduler::work, this);
+}
+
+BatchScheduler::~BatchScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+std::future<std::string> BatchScheduler::submit(std::string text) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queue.size() >= options.max_queue_depth) {
+        ++counters.blocked_submits;
+        not_full.wait(lock, [this] { return stopping || queue.size() < options.max_queue_depth; });
+    }
+    if (stopping)
+        throw std::runtime_error("BatchScheduler is shutting down");
+
+    queue.push_back({std::move(text), {}, Clock::now()});
+    std::future<std::string> result = queue.back().result.get_future();
+    ++counters.submitted;
+    counters.peak_queue_depth = std::max(counters.peak_queue_depth, queue.size());
+
+    // Будить поток нужно, только когда появился первый запрос (начинается отсчёт
+    // max_delay) или набрался полный пакет; иначе поток и так ждёт срока.
+    bool wake = queue.size() == 1 || queue.size() >= options.max_batch_size;
+    lock.unlock();
+    if (wake)
+        not_empty.notify_one();
+    return result;
+}
+
+BatchScheduler::Metrics BatchScheduler::metrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Metrics metrics = counters;
+    metrics.queue_depth = queue.size();
+    return metrics;
+}
+
+void BatchScheduler::work() {
+    std::vector<Request> batch;
+    std::vector<std::string> texts;
+    batch.reserve(options.max_batch_size);
+    texts.reserve(options.max_batch_size);
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            bool full = false;
+            for (;;) {
+                if (queue.empty()) {
+                    if (stopping)
+                        return;
+                    not_empty.wait(lock);
+                    continue;
+                }
+                full = queue.size() >= options.max_batch_size;
+                Clock::time_point deadline = queue.front().enqueued + options.max_delay;
+                if (full || stopping || Clock::now() >= deadline)
+                    break;
+                not_empty.wait_until(lock, deadline);
+            }
+
+            size_t count = std::min(queue.size(), options.max_batch_size);
+            Clock::time_point now = Clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - queue.front().enqueued);
+                counters.total_queue_wait += wait;
+                counters.max_queue_wait = std::max(counters.max_queue_wait, wait);
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            ++counters.batches;
+            counters.dispatched += count;
+            if (full)
+                ++counters.full_batches;
+            else if (stopping)
+                ++counters.shutdown_batches;
+            else
+                ++counters.deadline_batches;
+
+            // Оставшиеся запросы может забрать другой поток.
+            if (!queue.empty())
+                not_empty.notify_one();
+        }
+        not_full.notify_all();
+
+        for (Request &request : batch)
+            texts.push_back(std::move(request.text));
+
+        Clock::time_point start = Clock::now();
+        std::vector<std::string> translations;
+        std::exception_ptr error;
+        try {
+            translations = translator->translate_batch(texts);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+
+        // Счётчики обновляются до выдачи результатов, чтобы вызывающий их уже видел.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.total_batch_time += elapsed;
+            (error ? counters.failed : counters.completed) += batch.size();
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (error)
+                batch[i].result.set_exception(error);
+            else
+                batch[i].result.set_value(std::move(translations[i]));
+        }
+        batch.clear();
+        texts.clear();
+    }
+}
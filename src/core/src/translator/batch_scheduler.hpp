@@ -0,0 +1,147 @@
+#pragma once
+
+#include "traslator.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Параметры объединения запросов в пакеты.
+ */
+struct BatchSchedulerOptions {
+    size_t max_batch_size = 8;                       ///< Наибольшее число запросов в пакете.
+    std::chrono::microseconds max_delay{5000};       ///< Сколько первый запрос пакета может ждать остальных.
+    size_t max_queue_depth = 256;                    ///< Наибольшее число ожидающих запросов.
+    size_t workers = 0;                              ///< Потоков, переводящих пакеты; 0 — по числу реплик сессий.
+};
+
+/**
+ * @brief Планировщик, объединяющий запросы параллельных вызывающих в пакеты.
+ *
+ * Запросы складываются в очередь; пакет отправляется в Translator::translate_batch,
+ * как только в очереди набралось max_batch_size запросов или самый старый
+ * запрос прождал max_delay. Результат возвращается через std::future. Если
+ * очередь заполнена, submit ждёт освобождения места.
+ *
+ * Пример:
+ *   BatchScheduler scheduler(ModelRegistry::instance().get("en", "ru"));
+ *   std::future<std::string> result = scheduler.submit("Hello world");
+ *   std::string translated = result.get();
+ */
+class BatchScheduler {
+public:
+    /**
+     * @brief Счётчики работы планировщика для подбора размера пакета и задержки.
+     */
+    struct Metrics {
+        size_t max_batch_size = 0;                   ///< Настроенный размер пакета.
+        uint64_t submitted = 0;                      ///< Принятых запросов.
+        uint64_t dispatched = 0;                     ///< Запросов, взятых из очереди в пакеты.
+        uint64_t completed = 0;                      ///< Переведённых запросов.
+        uint64_t failed = 0;                         ///< Запросов, завершённых исключением.
+        uint64_t batches = 0;                        ///< Отправленных пакетов.
+        uint64_t full_batches = 0;                   ///< Пакетов, отправленных по размеру.
+        uint64_t deadline_batches = 0;               ///< Пакетов, отправленных по истечении max_delay.
+        uint64_t shutdown_batches = 0;               ///< Неполных пакетов, отправленных при остановке.
+        uint64_t blocked_submits = 0;                ///< Вызовов submit, ждавших места в очереди.
+        size_t queue_depth = 0;                      ///< Запросов в очереди сейчас.
+        size_t peak_queue_depth = 0;                 ///< Наибольшая длина очереди.
+        std::chrono::microseconds total_queue_wait{0}; ///< Суммарное ожидание запросов в очереди.
+        std::chrono::microseconds max_queue_wait{0};   ///< Наибольшее ожидание запроса в очереди.
+        std::chrono::microseconds total_batch_time{0}; ///< Суммарное время перевода пакетов.
+
+        /**
+         * @brief Средний размер пакета, включая пакеты, которые ещё переводятся.
+         */
+        double average_batch_size() const {
+            return batches ? double(dispatched) / batches : 0.0;
+        }
+
+        /**
+         * @brief Средняя заполненность пакета: средний размер, делённый на max_batch_size.
+         */
+        double batch_fill() const {
+            return max_batch_size ? average_batch_size() / max_batch_size : 0.0;
+        }
+
+        /**
+         * @brief Среднее ожидание запроса в очереди.
+         */
+        std::chrono::microseconds average_queue_wait() const {
+            auto taken = static_cast<std::chrono::microseconds::rep>(dispatched);
+            return taken ? total_queue_wait / taken : std::chrono::microseconds{0};
+        }
+    };
+
+    /**
+     * @brief Создаёт планировщик и запускает его потоки.
+     * @param translator Переводчик, которому отправляются пакеты.
+     * @param options Размер пакета, задержка, глубина очереди и число потоков.
+     * @throws std::invalid_argument Если translator пуст, max_batch_size или
+     *         max_queue_depth равны нулю.
+     */
+    explicit BatchScheduler(std::shared_ptr<const Translator> translator,
+                            const BatchSchedulerOptions &options = {});
+
+    /**
+     * @brief Переводит оставшиеся в очереди запросы, не дожидаясь max_delay, и останавливает потоки.
+     */
+    ~BatchScheduler();
+
+    BatchScheduler(const BatchScheduler &) = delete;
+    BatchScheduler &operator=(const BatchScheduler &) = delete;
+
+    /**
+     * @brief Ставит текст в очередь на перевод.
+     * @param text Входной текст.
+     * @return Перевод; если перевод пакета не удался, future хранит его исключение.
+     *
+     * Пример:
+     *   std::future<std::string> result = scheduler.submit("How are you?");
+     */
+    std::future<std::string> submit(std::string text);
+
+    /**
+     * @brief Возвращает счётчики работы планировщика.
+     *
+     * Пример:
+     *   BatchScheduler::Metrics metrics = scheduler.metrics();
+     *   double fill = metrics.batch_fill(); // близко к 1 — пакеты полные, можно увеличить размер
+     */
+    Metrics metrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Запрос в очереди.
+     */
+    struct Request {
+        std::string text;                   ///< Входной текст.
+        std::promise<std::string> result;   ///< Обещание перевода.
+        Clock::time_point enqueued;         ///< Время постановки в очередь.
+    };
+
+    std::shared_ptr<const Translator> translator; ///< Переводчик пакетов.
+    BatchSchedulerOptions options;                ///< Параметры пакетов.
+
+    mutable std::mutex mutex;                     ///< Защищает queue, stopping и counters.
+    std::condition_variable not_empty;            ///< Сигнал потокам: в очереди появились запросы.
+    std::condition_variable not_full;             ///< Сигнал submit: в очереди освободилось место.
+    std::deque<Request> queue;                    ///< Ожидающие запросы по времени поступления.
+    bool stopping = false;                        ///< Планировщик останавливается.
+    Metrics counters;                             ///< Счётчики работы.
+    std::vector<std::thread> workers;             ///< Потоки, переводящие пакеты.
+
+    /**
+     * @brief Цикл потока: собирает пакеты из очереди и переводит их.
+     */
+    void work();
+};
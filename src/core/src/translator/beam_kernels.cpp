@@ -0,0 +1,272 @@
+#include "beam_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BEAM_KERNELS_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BEAM_KERNELS_SSE2 1
+#endif
+
+namespace {
+
+#if defined(BEAM_KERNELS_AVX2)
+
+constexpr size_t kSimdWidth = 8;
+
+float horizontal_max(__m256 v) {
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+float horizontal_sum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// exp(x) для x <= 0: разложение x = n*ln2 + r и полином Cephes для exp(r).
+__m256 exp_nonpositive(__m256 x) {
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+    __m256 fx = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)), _mm256_set1_ps(0.5f));
+    __m256 n = _mm256_floor_ps(fx);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(0.693359375f)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(-2.12194440e-4f)));
+
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(r, r)), _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+
+    __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+}
+
+float max_simd(const float *data, size_t count, size_t &done) {
+    __m256 m = _mm256_loadu_ps(data);
+    for (done = kSimdWidth; done + kSimdWidth <= count; done += kSimdWidth)
+        m = _mm256_max_ps(m, _mm256_loadu_ps(data + done));
+    return horizontal_max(m);
+}
+
+float sum_exp_simd(const float *data, size_t count, float shift, size_t &done) {
+    __m256 s = _mm256_setzero_ps();
+    __m256 offset = _mm256_set1_ps(shift);
+    for (done = 0; done + kSimdWidth <= count; done += kSimdWidth)
+        s = _mm256_add_ps(s, exp_nonpositive(_mm256_sub_ps(_mm256_loadu_ps(data + done), offset)));
+    return horizontal_sum(s);
+}
+
+// Маска элементов блока, строго больших порога.
+unsigned above_mask(const float *data, float bound) {
+    __m256 cmp = _mm256_cmp_ps(_mm256_loadu_ps(data), _mm256_set1_ps(bound), _CMP_GT_OQ);
+    return static_cast<unsigned>(_mm256_movemask_ps(cmp));
+}
+
+#elif defined(BEAM_KERNELS_SSE2)
+
+constexpr size_t kSimdWidth = 4;
+
+float horizontal_max(__m128 m) {
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+
+float horizontal_sum(__m128 s) {
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// exp(x) для x <= 0: разложение x = n*ln2 + r и полином Cephes для exp(r).
+__m128 exp_nonpositive(__m128 x) {
+    x = _mm_max_ps(x, _mm_set1_ps(-87.0f));
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)), _mm_set1_ps(0.5f));
+    // В SSE2 нет floor: усечение к нулю и поправка для отрицательных значений.
+    __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), _mm_set1_ps(1.0f)));
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(r, r)), _mm_add_ps(r, _mm_set1_ps(1.0f)));
+
+    __m128i exponent = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(exponent));
+}
+
+float max_simd(const float *data, size_t count, size_t &done) {
+    __m128 m = _mm_loadu_ps(data);
+    for (done = kSimdWidth; done + kSimdWidth <= count; done += kSimdWidth)
+        m = _mm_max_ps(m, _mm_loadu_ps(data + done));
+    return horizontal_max(m);
+}
+
+float sum_exp_simd(const float *data, size_t count, float shift, size_t &done) {
+    __m128 s = _mm_setzero_ps();
+    __m128 offset = _mm_set1_ps(shift);
+    for (done = 0; done + kSimdWidth <= count; done += kSimdWidth)
+        s = _mm_add_ps(s, exp_nonpositive(_mm_sub_ps(_mm_loadu_ps(data + done), offset)));
+    return horizontal_sum(s);
+}
+
+// Маска элементов блока, строго больших порога.
+unsigned above_mask(const float *data, float bound) {
+    __m128 cmp = _mm_cmpgt_ps(_mm_loadu_ps(data), _mm_set1_ps(bound));
+    return static_cast<unsigned>(_mm_movemask_ps(cmp));
+}
+
+#endif
+
+size_t count_trailing_zeros(unsigned bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return index;
+#else
+    return static_cast<size_t>(__builtin_ctz(bits));
+#endif
+}
+
+} // namespace
+
+float max_value(const float *logits, size_t count) {
+    size_t i = 0;
+    float max_logit = logits[0];
+#if defined(BEAM_KERNELS_AVX2) || defined(BEAM_KERNELS_SSE2)
+    if (count >= kSimdWidth)
+        max_logit = max_simd(logits, count, i);
+#endif
+    for (; i < count; ++i)
+        max_logit = std::max(max_logit, logits[i]);
+    return max_logit;
+}
+
+size_t argmax(const float *logits, size_t count) {
+    return std::find(logits, logits + count, max_value(logits, count)) - logits;
+}
+
+size_t find_above(const float *logits, size_t begin, size_t end, float bound) {
+    size_t i = begin;
+#if defined(BEAM_KERNELS_AVX2) || defined(BEAM_KERNELS_SSE2)
+    for (; i + kSimdWidth <= end; i += kSimdWidth) {
+        unsigned mask = above_mask(logits + i, bound);
+        if (mask)
+            return i + count_trailing_zeros(mask);
+    }
+#endif
+    for (; i < end; ++i)
+        if (logits[i] > bound)
+            return i;
+    return end;
+}
+
+float log_sum_exp(const float *logits, size_t count) {
+    float max_logit = max_value(logits, count);
+
+    size_t i = 0;
+    double sum = 0.0;
+#if defined(BEAM_KERNELS_AVX2) || defined(BEAM_KERNELS_SSE2)
+    sum = sum_exp_simd(logits, count, max_logit, i);
+#endif
+    for (; i < count; ++i)
+        sum += std::exp(logits[i] - max_logit);
+    return max_logit + static_cast<float>(std::log(sum));
+}
+
+void select_top_candidates(const float *logits, size_t beam_count, size_t vocab_size,
+                           const float *beam_scores, size_t k,
+                           std::vector<BeamCandidate> &candidates) {
+    candidates.clear();
+    if (k == 0 || vocab_size == 0)
+        return;
+
+    for (size_t beam = 0; beam < beam_count; ++beam) {
+        const float *row = logits + beam * vocab_size;
+        // Оценка токена: offset + logit, где offset = beam_score - log_sum_exp.
+        float offset = beam_scores[beam] - log_sum_exp(row, vocab_size);
+
+        // Куча хранит худшего из выбранных кандидатов на вершине.
+        auto consider = [&](size_t token) {
+            BeamCandidate candidate{offset + row[token], beam, static_cast<int64_t>(token)};
+            if (candidates.size() < k) {
+                candidates.push_back(candidate);
+                std::push_heap(candidates.begin(), candidates.end(), better_candidate);
+            } else if (better_candidate(candidate, candidates.front())) {
+                std::pop_heap(candidates.begin(), candidates.end(), better_candidate);
+                candidates.back() = candidate;
+                std::push_heap(candidates.begin(), candidates.end(), better_candidate);
+            }
+        };
+
+        size_t token = 0;
+#if defined(BEAM_KERNELS_AVX2) || defined(BEAM_KERNELS_SSE2)
+        for (; token + kSimdWidth <= vocab_size; token += kSimdWidth) {
+            if (candidates.size() < k) {
+                for (size_t lane = 0; lane < kSimdWidth; ++lane)
+                    consider(token + lane);
+                continue;
+            }
+            // Порог в пространстве логитов: блок без превышений пропускается целиком.
+            unsigned mask = above_mask(row + token, candidates.front().score - offset);
+            for (size_t lane = 0; mask; ++lane, mask >>= 1)
+                if (mask & 1)
+                    consider(token + lane);
+        }
+#endif
+        for (; token < vocab_size; ++token)
+            consider(token);
+    }
+
+    std::sort_heap(candidates.begin(), candidates.end(), better_candidate);
+}
+
+size_t merge_top_candidates(const float *log_probs, const int64_t *token_ids, size_t beam_count,
+                            size_t k, const float *beam_scores, BeamCandidate *best,
+                            size_t capacity) {
+    size_t count = 0;
+    for (size_t beam = 0; beam < beam_count; ++beam) {
+        for (size_t i = 0; i < k; ++i) {
+            BeamCandidate candidate{beam_scores[beam] + log_probs[beam * k + i], beam,
+                                    token_ids[beam * k + i]};
+            if (count == capacity && !better_candidate(candidate, best[capacity - 1])) {
+                // Дальше в строке оценки не выше; равные ещё могут идти с меньшим токеном.
+                if (candidate.score < best[capacity - 1].score)
+                    break;
+                continue;
+            }
+
+            size_t position = count < capacity ? count++ : capacity - 1;
+            for (; position > 0 && better_candidate(candidate, best[position - 1]); --position)
+                best[position] = best[position - 1];
+            best[position] = candidate;
+        }
+    }
+    return count;
+}
+
+void merge_top_candidates(const float *log_probs, const int64_t *token_ids, size_t beam_count,
+                          size_t k, const float *beam_scores, size_t capacity,
+                          std::vector<BeamCandidate> &candidates) {
+    candidates.resize(capacity);
+    candidates.resize(merge_top_candidates(log_probs, token_ids, beam_count, k, beam_scores,
+                                           candidates.data(), capacity));
+}
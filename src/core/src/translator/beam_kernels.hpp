@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Продолжение луча: луч-родитель, добавляемый токен и итоговая оценка.
+ */
+struct BeamCandidate {
+    float score;   ///< Оценка луча после добавления токена (сумма log-вероятностей).
+    size_t beam;   ///< Индекс луча-родителя в пакете.
+    int64_t token; ///< Идентификатор добавляемого токена.
+};
+
+/**
+ * @brief Порядок продолжений: по убыванию оценки, при равной оценке — по лучу и токену.
+ * @return true, если a должно стоять раньше b.
+ *
+ * Все способы отбора упорядочивают кандидатов этим сравнением, поэтому при
+ * равных логитах выбирают одни и те же продолжения в одном порядке.
+ */
+inline bool better_candidate(const BeamCandidate &a, const BeamCandidate &b) {
+    if (a.score != b.score)
+        return a.score > b.score;
+    if (a.beam != b.beam)
+        return a.beam < b.beam;
+    return a.token < b.token;
+}
+
+/**
+ * @brief Возвращает наибольший логит.
+ * @param logits Указатель на логиты.
+ * @param count Количество логитов (больше нуля).
+ */
+float max_value(const float *logits, size_t count);
+
+/**
+ * @brief Возвращает индекс первого наибольшего логита.
+ * @param logits Указатель на логиты.
+ * @param count Количество логитов (больше нуля).
+ *
+ * Используется жадным декодированием: softmax для выбора не нужен.
+ */
+size_t argmax(const float *logits, size_t count);
+
+/**
+ * @brief Находит первый логит, строго больший порога.
+ * @param logits Указатель на логиты.
+ * @param begin Индекс, с которого начинается поиск.
+ * @param end Индекс конца диапазона.
+ * @param bound Порог.
+ * @return Индекс найденного логита или end.
+ *
+ * Блоки логитов проверяются одним векторным сравнением.
+ */
+size_t find_above(const float *logits, size_t begin, size_t end, float bound);
+
+/**
+ * @brief Вычисляет log(sum(exp(logits))) численно устойчиво.
+ * @param logits Указатель на логиты.
+ * @param count Количество логитов (больше нуля).
+ * @return Логарифм суммы экспонент.
+ *
+ * Два прохода без промежуточных массивов: максимум и сумма exp(x - max).
+ * Проходы векторизованы инструкциями AVX2 (если сборка с AVX2) или SSE2,
+ * на остальных платформах используется скалярный код.
+ */
+float log_sum_exp(const float *logits, size_t count);
+
+/**
+ * @brief Выбирает k лучших продолжений сразу по всем лучам пакета.
+ * @param logits Логиты пакета: [beam_count, vocab_size].
+ * @param beam_count Количество лучей.
+ * @param vocab_size Размер словаря.
+ * @param beam_scores Текущие оценки лучей (beam_count значений).
+ * @param k Количество выбираемых продолжений.
+ * @param candidates Заполняется не более чем k продолжениями по убыванию оценки.
+ *
+ * Оценка продолжения — beam_score + log_softmax(logits)[token]; вероятности
+ * не материализуются. Лучшие k кандидатов всех лучей хранятся в одной куче,
+ * а блоки логитов, не превосходящие её порога, отбрасываются векторным
+ * сравнением. Если у candidates достаточная ёмкость, память не выделяется.
+ *
+ * Пример:
+ *   std::vector<BeamCandidate> best;
+ *   select_top_candidates(logits.data(), 3, vocab, scores.data(), 3, best);
+ *   // best[0] — лучшее продолжение среди всех трёх лучей
+ */
+void select_top_candidates(const float *logits, size_t beam_count, size_t vocab_size,
+                           const float *beam_scores, size_t k,
+                           std::vector<BeamCandidate> &candidates);
+
+/**
+ * @brief Выбирает K лучших продолжений по всем лучам в массив фиксированного размера.
+ * @tparam K Количество выбираемых продолжений (известно при компиляции).
+ * @param logits Логиты пакета: [beam_count, vocab_size].
+ * @param beam_count Количество лучей.
+ * @param vocab_size Размер словаря.
+ * @param beam_scores Текущие оценки лучей.
+ * @param best Заполняется продолжениями по убыванию оценки.
+ * @return Количество заполненных элементов best.
+ *
+ * Вариант select_top_candidates для небольших K: вместо кучи кандидаты
+ * вставляются в отсортированный std::array, цикл вставки разворачивается
+ * компилятором. Логиты ниже текущего порога пропускаются через find_above.
+ */
+template <size_t K>
+size_t select_top_candidates(const float *logits, size_t beam_count, size_t vocab_size,
+                             const float *beam_scores, std::array<BeamCandidate, K> &best) {
+    size_t count = 0;
+    for (size_t beam = 0; beam < beam_count; ++beam) {
+        const float *row = logits + beam * vocab_size;
+        float offset = beam_scores[beam] - log_sum_exp(row, vocab_size);
+        float bound = count < K ? -std::numeric_limits<float>::infinity() : best[K - 1].score - offset;
+
+        for (size_t token = find_above(row, 0, vocab_size, bound); token < vocab_size;
+             token = find_above(row, token + 1, vocab_size, bound)) {
+            BeamCandidate candidate{offset + row[token], beam, static_cast<int64_t>(token)};
+            // Логит выше порога после прибавления offset может округлиться до оценки худшего.
+            if (count == K && !better_candidate(candidate, best[K - 1]))
+                continue;
+            size_t position = count < K ? count++ : K - 1;
+            for (; position > 0 && better_candidate(candidate, best[position - 1]); --position)
+                best[position] = best[position - 1];
+            best[position] = candidate;
+
+            if (count == K)
+                bound = best[K - 1].score - offset;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Объединяет лучшие продолжения лучей, выбранные моделью (голова TopK).
+ * @param log_probs Log-вероятности лучших токенов каждого луча по убыванию: [beam_count, k].
+ * @param token_ids Идентификаторы этих токенов: [beam_count, k].
+ * @param beam_count Количество лучей.
+ * @param k Количество продолжений каждого луча.
+ * @param beam_scores Текущие оценки лучей.
+ * @param best Массив не меньше capacity элементов; заполняется по убыванию оценки.
+ * @param capacity Количество выбираемых продолжений.
+ * @return Количество заполненных элементов best.
+ *
+ * Результат совпадает с select_top_candidates по полным логитам, если
+ * k >= capacity. Строки упорядочены, поэтому луч просматривается, пока его
+ * продолжения не хуже худшего выбранного; равные оценки внутри строки могут
+ * идти в любом порядке токенов и сравниваются через better_candidate.
+ */
+size_t merge_top_candidates(const float *log_probs, const int64_t *token_ids, size_t beam_count,
+                            size_t k, const float *beam_scores, BeamCandidate *best,
+                            size_t capacity);
+
+/**
+ * @brief Вариант merge_top_candidates, заполняющий вектор не более чем capacity продолжениями.
+ *
+ * Если у candidates достаточная ёмкость, память не выделяется.
+ */
+void merge_top_candidates(const float *log_probs, const int64_t *token_ids, size_t beam_count,
+                          size_t k, const float *beam_scores, size_t capacity,
+                          std::vector<BeamCandidate> &candidates);
+
+/**
+ * @brief Вариант merge_top_candidates для массива фиксированного размера.
+ * @tparam K Количество выбираемых продолжений.
+ */
+template <size_t K>
+size_t merge_top_candidates(const float *log_probs, const int64_t *token_ids, size_t beam_count,
+                            size_t k, const float *beam_scores,
+                            std::array<BeamCandidate, K> &best) {
+    return merge_top_candidates(log_probs, token_ids, beam_count, k, beam_scores, best.data(), K);
+}
@@ -0,0 +1,24 @@
+#include "beam_search.hpp"
+
+void GreedySearch::reset(int64_t start_token, size_t, size_t max_length, const BeamSearchOptions &) {
+    tokens.reserve(max_length + 1);
+    tokens.assign(1, start_token);
+    finished = false;
+}
+
+void GreedySearch::step(const float *logits, size_t vocab_size, int64_t eos_token_id) {
+    int64_t token = static_cast<int64_t>(argmax(logits, vocab_size));
+    tokens.push_back(token);
+    finished = token == eos_token_id;
+}
+
+void GreedySearch::step_top_k(const float *, const int64_t *token_ids, size_t,
+                              int64_t eos_token_id) {
+    tokens.push_back(token_ids[0]);
+    finished = token_ids[0] == eos_token_id;
+}
+
+bool GreedySearch::best(std::vector<int64_t> &tokens) const {
+    tokens = this->tokens;
+    return true;
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+#include "beam_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Параметры завершения поиска по лучу.
+ */
+struct BeamSearchOptions {
+    /**
+     * Степень штрафа за длину: завершённые гипотезы сравниваются по
+     * score / length^length_penalty, где length — число сгенерированных токенов.
+     * 0 — без нормализации, больше 0 — предпочтение более длинным переводам.
+     */
+    float length_penalty = 1.0f;
+
+    /**
+     * Останавливать поиск, как только ни одна незавершённая гипотеза даже в
+     * лучшем случае не может превзойти лучшую завершённую (оптимистичная оценка).
+     */
+    bool optimistic_stop = false;
+};
+
+/**
+ * @brief Набор значений одного шага поиска ёмкостью не более N.
+ *
+ * Для N > 0 хранится в std::array, для N == 0 — в std::vector, ёмкость
+ * которого задаётся reserve.
+ */
+template <class T, size_t N>
+class BeamSlots {
+public:
+    void reserve(size_t) {}
+    void clear() { count = 0; }
+    void assign(size_t n, const T &value) { std::fill_n(items.begin(), count = n, value); }
+    void push_back(const T &value) { items[count++] = value; }
+    void swap(BeamSlots &other) { std::swap(*this, other); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T *data() const { return items.data(); }
+    const T &operator[](size_t i) const { return items[i]; }
+    const T *begin() const { return items.data(); }
+    const T *end() const { return items.data() + count; }
+
+private:
+    std::array<T, N> items{};
+    size_t count = 0;
+};
+
+template <class T>
+class BeamSlots<T, 0> {
+public:
+    void reserve(size_t n) { items.reserve(n); }
+    void clear() { items.clear(); }
+    void assign(size_t n, const T &value) { items.assign(n, value); }
+    void push_back(const T &value) { items.push_back(value); }
+    void swap(BeamSlots &other) { items.swap(other.items); }
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    const T *data() const { return items.data(); }
+    const T &operator[](size_t i) const { return items[i]; }
+    const T *begin() const { return items.data(); }
+    const T *end() const { return items.data() + items.size(); }
+
+private:
+    std::vector<T> items;
+};
+
+/**
+ * @brief Состояние поиска по лучу, хранящее гипотезы обратными ссылками.
+ * @tparam N Ширина луча, известная при компиляции, или 0 — ширина задаётся в reset.
+ *
+ * На каждом шаге сохраняется не более beam_width незавершённых и beam_width
+ * завершённых гипотез вида {родитель, токен, оценка} в массиве, размер
+ * которого задаётся один раз при reset. Последовательности токенов не
+ * копируются: они восстанавливаются проходом по родителям. После reset шаги
+ * поиска не выделяют память.
+ *
+ * При N > 0 состояние шага и кандидаты лежат в std::array, а отбор
+ * кандидатов — вставкой в отсортированный массив фиксированного размера.
+ *
+ * Поиск завершается, когда закончены beam_width гипотез, не осталось
+ * незавершённых или (с optimistic_stop) лучшая завершённая гипотеза уже не
+ * может быть превзойдена.
+ *
+ * Пример:
+ *   BeamSearch search;
+ *   search.reset(pad_id, 3, 50);
+ *   for (int step = 0; step < 50 && !search.done(); ++step) {
+ *       ... // логиты для search.last_tokens()
+ *       search.step(logits.data(), vocab_size, eos_id);
+ *   }
+ *   std::vector<int64_t> tokens;
+ *   search.best(tokens);
+ */
+template <size_t N>
+class BasicBeamSearch {
+public:
+    /**
+     * @brief Гипотеза одного шага поиска.
+     */
+    struct Hypothesis {
+        int64_t parent; ///< Индекс гипотезы-родителя в общем массиве (-1 для начальной).
+        int64_t token;  ///< Токен, добавленный на этом шаге.
+        float score;    ///< Оценка последовательности до этого токена включительно.
+    };
+
+    /**
+     * @brief Начинает новый поиск с одной гипотезой из начального токена.
+     * @param start_token Начальный токен декодера.
+     * @param beam_width Количество лучей (при N > 0 должно быть равно N).
+     * @param max_length Максимальное число шагов.
+     * @param options Параметры завершения поиска.
+     * @throws std::invalid_argument Если beam_width не совпадает с N.
+     *
+     * Память выделяется, только если текущей ёмкости недостаточно.
+     */
+    void reset(int64_t start_token, size_t beam_width, size_t max_length,
+               const BeamSearchOptions &options = {}) {
+        if (N != 0 && beam_width != N)
+            throw std::invalid_argument("beam_width does not match the beam search specialization");
+
+        width = beam_width;
+        limit = max_length;
+        step_count = 0;
+        this->options = options;
+        nodes.resize((max_length + 1) * 2 * width);
+        live.reserve(width);
+        next_live.reserve(width);
+        live_parents.reserve(width);
+        live_scores.reserve(width);
+        live_tokens.reserve(width);
+        if constexpr (N == 0)
+            candidates.reserve(2 * width);
+        completed.reserve(max_length * width);
+
+        nodes[0] = {-1, start_token, 0.0f};
+        live.assign(1, 0);
+        live_parents.assign(1, 0);
+        live_scores.assign(1, 0.0f);
+        live_tokens.assign(1, start_token);
+        completed.clear();
+    }
+
+    /**
+     * @brief Проверяет, можно ли прекратить поиск.
+     */
+    bool done() const {
+        if (live.empty() || completed.size() >= width)
+            return true;
+        if (!options.optimistic_stop || completed.empty())
+            return false;
+
+        // Оценки только убывают, поэтому лучшая возможная нормализованная оценка луча
+        // достигается при наибольшей длине (штраф > 0) или при наименьшей (штраф <= 0).
+        size_t length = options.length_penalty > 0.0f ? limit : step_count + 1;
+        float best_live = *std::max_element(live_scores.begin(), live_scores.end());
+        return normalized(best_live, length) <= best_finished;
+    }
+
+    /**
+     * @brief Возвращает количество незавершённых гипотез.
+     */
+    size_t live_count() const { return live.size(); }
+
+    /**
+     * @brief Возвращает длину каждой незавершённой гипотезы в токенах.
+     */
+    size_t length() const { return step_count + 1; }
+
+    /**
+     * @brief Возвращает оценки незавершённых гипотез.
+     */
+    const float *scores() const { return live_scores.data(); }
+
+    /**
+     * @brief Возвращает последние токены незавершённых гипотез.
+     */
+    const int64_t *last_tokens() const { return live_tokens.data(); }
+
+    /**
+     * @brief Возвращает для каждой незавершённой гипотезы индекс её родителя
+     *        среди гипотез предыдущего шага (live_count() значений).
+     */
+    const size_t *parents() const { return live_parents.data(); }
+
+    /**
+     * @brief Записывает все токены незавершённой гипотезы.
+     * @param beam Индекс гипотезы среди незавершённых.
+     * @param out Буфер не меньше length() элементов.
+     */
+    void prefix(size_t beam, int64_t *out) const {
+        int64_t index = static_cast<int64_t>(live[beam]);
+        for (size_t position = step_count + 1; position-- > 0;) {
+            out[position] = nodes[index].token;
+            index = nodes[index].parent;
+        }
+    }
+
+    /**
+     * @brief Выполняет шаг поиска по логитам незавершённых гипотез.
+     * @param logits Логиты: [live_count(), vocab_size].
+     * @param vocab_size Размер словаря.
+     * @param eos_token_id Токен конца последовательности.
+     *
+     * Отбирает 2 * beam_width лучших продолжений по всем лучам сразу: запас
+     * позволяет заполнить лучи, даже если часть продолжений — eos.
+     */
+    void step(const float *logits, size_t vocab_size, int64_t eos_token_id) {
+        if constexpr (N == 0) {
+            select_top_candidates(logits, live.size(), vocab_size, live_scores.data(), 2 * width,
+                                  candidates);
+            advance(candidates.data(), candidates.size(), eos_token_id);
+        } else {
+            size_t count = select_top_candidates(logits, live.size(), vocab_size,
+                                                 live_scores.data(), candidates);
+            advance(candidates.data(), count, eos_token_id);
+        }
+    }
+
+    /**
+     * @brief Выполняет шаг поиска по лучшим токенам, выбранным моделью.
+     * @param log_probs Log-вероятности лучших токенов по убыванию: [live_count(), k].
+     * @param token_ids Идентификаторы этих токенов: [live_count(), k].
+     * @param k Количество токенов на гипотезу (не меньше 2 * beam_width для
+     *        совпадения с step по полным логитам).
+     * @param eos_token_id Токен конца последовательности.
+     */
+    void step_top_k(const float *log_probs, const int64_t *token_ids, size_t k,
+                    int64_t eos_token_id) {
+        if constexpr (N == 0) {
+            merge_top_candidates(log_probs, token_ids, live.size(), k, live_scores.data(),
+                                 2 * width, candidates);
+            advance(candidates.data(), candidates.size(), eos_token_id);
+        } else {
+            size_t count = merge_top_candidates(log_probs, token_ids, live.size(), k,
+                                                live_scores.data(), candidates);
+            advance(candidates.data(), count, eos_token_id);
+        }
+    }
+
+    /**
+     * @brief Выполняет шаг поиска по готовым продолжениям.
+     * @param candidates Продолжения по убыванию оценки (см. select_top_candidates),
+     *        обычно 2 * beam_width штук.
+     * @param count Количество продолжений.
+     * @param eos_token_id Токен конца последовательности.
+     * @throws std::out_of_range Если шагов больше, чем max_length.
+     *
+     * Продолжения с eos_token_id среди beam_width лучших становятся завершёнными
+     * гипотезами; остальные продолжения заполняют до beam_width незавершённых.
+     */
+    void advance(const BeamCandidate *candidates, size_t count, int64_t eos_token_id) {
+        size_t base = (step_count + 1) * 2 * width;
+        if (base + 2 * width > nodes.size())
+            throw std::out_of_range("Beam search exceeded max_length");
+
+        next_live.clear();
+        live_parents.clear();
+        live_scores.clear();
+        live_tokens.clear();
+
+        size_t used = 0;
+        for (size_t rank = 0; rank < count && next_live.size() < width; ++rank) {
+            const BeamCandidate &candidate = candidates[rank];
+            bool finished = candidate.token == eos_token_id;
+            // Как и в обычном beam search, завершаются только продолжения из beam_width лучших.
+            if (finished && rank >= width)
+                continue;
+
+            size_t index = base + used++;
+            nodes[index] = {static_cast<int64_t>(live[candidate.beam]), candidate.token,
+                            candidate.score};
+
+            if (finished) {
+                float score = normalized(candidate.score, step_count + 1);
+                best_finished = completed.empty() ? score : std::max(best_finished, score);
+                completed.push_back(index);
+            } else {
+                next_live.push_back(index);
+                live_parents.push_back(candidate.beam);
+                live_scores.push_back(candidate.score);
+                live_tokens.push_back(candidate.token);
+            }
+        }
+
+        live.swap(next_live);
+        ++step_count;
+    }
+
+    /**
+     * @brief Выполняет шаг поиска по готовым продолжениям.
+     */
+    void advance(const std::vector<BeamCandidate> &candidates, int64_t eos_token_id) {
+        advance(candidates.data(), candidates.size(), eos_token_id);
+    }
+
+    /**
+     * @brief Восстанавливает лучшую гипотезу.
+     * @param tokens Заполняется токенами гипотезы, начиная с начального.
+     * @return false, если гипотез нет.
+     *
+     * Предпочитаются завершённые гипотезы (по оценке со штрафом за длину);
+     * если их нет — лучшая из незавершённых. Если поиск исчерпал max_length
+     * шагов, незавершённые гипотезы сравниваются с завершёнными по той же
+     * оценке, как при финализации поиска в transformers.
+     */
+    bool best(std::vector<int64_t> &tokens) const {
+        if (completed.empty() && live.empty())
+            return false;
+
+        size_t best_index = 0;
+        float best_score = 0.0f;
+        bool found = false;
+        auto consider = [&](size_t index, size_t length) {
+            float score = normalized(nodes[index].score, length);
+            if (!found || score > best_score) {
+                best_score = score;
+                best_index = index;
+                found = true;
+            }
+        };
+        for (size_t index : completed)
+            consider(index, index / (2 * width));
+        if (completed.empty() || step_count >= limit)
+            for (size_t index : live)
+                consider(index, step_count);
+
+        tokens.clear();
+        for (int64_t index = static_cast<int64_t>(best_index); index >= 0;
+             index = nodes[index].parent)
+            tokens.push_back(nodes[index].token);
+        std::reverse(tokens.begin(), tokens.end());
+        return true;
+    }
+
+private:
+    using Candidates = std::conditional_t<N == 0, std::vector<BeamCandidate>,
+                                          std::array<BeamCandidate, 2 * N>>;
+
+    size_t width = N;                    ///< Количество лучей.
+    size_t limit = 0;                    ///< Максимальное число шагов.
+    size_t step_count = 0;               ///< Номер текущего шага.
+    BeamSearchOptions options;           ///< Параметры завершения.
+    float best_finished = 0.0f;          ///< Лучшая нормализованная оценка завершённых гипотез.
+    std::vector<Hypothesis> nodes;       ///< Гипотезы всех шагов: шаг s занимает [s * 2w, (s + 1) * 2w).
+    BeamSlots<size_t, N> live;           ///< Индексы незавершённых гипотез текущего шага.
+    BeamSlots<size_t, N> next_live;      ///< Буфер для live следующего шага.
+    BeamSlots<size_t, N> live_parents;   ///< Родители незавершённых гипотез среди live предыдущего шага.
+    BeamSlots<float, N> live_scores;     ///< Оценки незавершённых гипотез.
+    BeamSlots<int64_t, N> live_tokens;   ///< Последние токены незавершённых гипотез.
+    Candidates candidates{};             ///< Кандидаты текущего шага.
+    std::vector<size_t> completed;       ///< Индексы завершённых гипотез.
+
+    /**
+     * @brief Оценка последовательности из length сгенерированных токенов со штрафом за длину.
+     */
+    float normalized(float score, size_t length) const {
+        if (options.length_penalty == 0.0f)
+            return score;
+        return score / std::pow(static_cast<float>(std::max<size_t>(length, 1)),
+                                options.length_penalty);
+    }
+};
+
+/**
+ * @brief Поиск по лучу с шириной, заданной во время выполнения.
+ */
+using BeamSearch = BasicBeamSearch<0>;
+
+/**
+ * @brief Поиск по лучу с шириной N, известной при компиляции.
+ */
+template <size_t N>
+using FixedBeamSearch = BasicBeamSearch<N>;
+
+/**
+ * @brief Жадное декодирование: на каждом шаге выбирается самый вероятный токен.
+ *
+ * Интерфейс совпадает с BasicBeamSearch, но состояние — одна последовательность,
+ * а выбор — argmax по логитам без softmax и без кучи кандидатов.
+ */
+class GreedySearch {
+public:
+    /**
+     * @brief Начинает новый поиск; beam_width и options не используются.
+     */
+    void reset(int64_t start_token, size_t beam_width, size_t max_length,
+               const BeamSearchOptions &options = {});
+
+    bool done() const { return finished; }
+    size_t live_count() const { return finished ? 0 : 1; }
+    size_t length() const { return tokens.size(); }
+    const int64_t *last_tokens() const { return &tokens.back(); }
+    const size_t *parents() const { return &parent; }
+    void prefix(size_t, int64_t *out) const { std::copy(tokens.begin(), tokens.end(), out); }
+
+    /**
+     * @brief Добавляет токен с наибольшим логитом.
+     * @param logits Логиты единственной гипотезы.
+     * @param vocab_size Размер словаря.
+     * @param eos_token_id Токен конца последовательности.
+     */
+    void step(const float *logits, size_t vocab_size, int64_t eos_token_id);
+
+    /**
+     * @brief Добавляет первый из лучших токенов, выбранных моделью.
+     * @param log_probs Не используется: токены уже упорядочены.
+     * @param token_ids Идентификаторы лучших токенов по убыванию вероятности.
+     * @param k Количество токенов.
+     * @param eos_token_id Токен конца последовательности.
+     */
+    void step_top_k(const float *log_probs, const int64_t *token_ids, size_t k,
+                    int64_t eos_token_id);
+
+    /**
+     * @brief Возвращает сгенерированную последовательность.
+     */
+    bool best(std::vector<int64_t> &tokens) const;
+
+private:
+    std::vector<int64_t> tokens; ///< Последовательность, начиная с начального токена.
+    bool finished = false;       ///< Сгенерирован eos.
+    size_t parent = 0;           ///< Родитель единственной гипотезы (всегда 0).
+};
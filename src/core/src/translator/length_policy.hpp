@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Правило выбора максимальной длины перевода по длине входа.
+ *
+ * Бюджет шагов декодера равен ratio * source_length + offset, но не больше cap.
+ * Короткие фразы перестают декодироваться до фиксированного предела, а
+ * длинные предложения не обрезаются.
+ *
+ * Пример:
+ *   LengthPolicy policy = LengthPolicy::for_language_pair("en", "ru");
+ *   policy.budget(4);   // 16
+ *   policy.budget(400); // 512 (предел модели)
+ */
+struct LengthPolicy {
+    float ratio = 0.0f; ///< Число шагов на один входной токен.
+    int offset = 50;    ///< Постоянный запас шагов.
+    int cap = 50;       ///< Жёсткий предел числа шагов.
+
+    /**
+     * @brief Возвращает число шагов декодера для входа заданной длины.
+     * @param source_length Количество входных токенов.
+     */
+    int budget(size_t source_length) const {
+        float steps = std::ceil(ratio * static_cast<float>(source_length)) + offset;
+        return static_cast<int>(std::min(steps, static_cast<float>(cap)));
+    }
+
+    /**
+     * @brief Фиксированный бюджет, не зависящий от длины входа.
+     * @param max_length Число шагов.
+     */
+    static LengthPolicy fixed(int max_length) { return {0.0f, max_length, max_length}; }
+
+    /**
+     * @brief Возвращает правило для языковой пары моделей opus-mt.
+     * @param source Код исходного языка ("en", "ru").
+     * @param target Код языка перевода.
+     *
+     * Коэффициенты учитывают, что в словаре SentencePiece русский текст
+     * занимает больше токенов, чем английский. Предел равен числу позиций
+     * модели Marian (512).
+     */
+    static LengthPolicy for_language_pair(const std::string &source, const std::string &target) {
+        if (source == "en" && target == "ru")
+            return {1.5f, 10, 512};
+        if (source == "ru" && target == "en")
+            return {1.2f, 10, 512};
+        return {1.5f, 10, 512};
+    }
+};
@@ -0,0 +1,99 @@
+#include "model_registry.hpp"
+#include <stdexcept>
+
+ModelRegistry &ModelRegistry::instance() {
+    static ModelRegistry registry;
+    return registry;
+}
+
+ModelRegistry::Key ModelRegistry::key(const ModelConfig &config) {
+    return Key(config.source_language, config.target_language, config.encoder_path);
+}
+
+std::shared_ptr<ModelRegistry::Entry> ModelRegistry::register_entry(const ModelConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Entry> &entry = entries[key(config)];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+        entry->config = config;
+        order.push_back(entry);
+    }
+    return entry;
+}
+
+std::shared_ptr<ModelRegistry::Entry> ModelRegistry::find(const std::string &source,
+                                                          const std::string &target) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::shared_ptr<Entry> &entry : order)
+        if (entry->config.source_language == source && entry->config.target_language == target)
+            return entry;
+    throw std::out_of_range("No model registered for " + source + "-" + target);
+}
+
+std::shared_ptr<const Translator> ModelRegistry::load(Entry &entry) {
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    if (entry.translator)
+        return entry.translator;
+
+    const ModelConfig &config = entry.config;
+    entry.state = ModelState::Loading;
+    try {
+        Tokenizer tokenizer(config.vocab_path);
+        auto translator = std::make_shared<Translator>(
+            tokenizer, config.encoder_path, config.decoder_path, config.pad_token_id,
+            config.eos_token_id, 50, config.beam_width, config.decoder_with_past_path,
+            config.runtime_options);
+        translator->set_length_policy(
+            LengthPolicy::for_language_pair(config.source_language, config.target_language));
+        entry.translator = translator;
+        entry.error.clear();
+        entry.state = ModelState::Ready;
+    } catch (const std::exception &e) {
+        // Неудачная загрузка повторяется при следующем обращении.
+        entry.error = e.what();
+        entry.state = ModelState::Failed;
+        throw std::runtime_error("Failed to load model " + config.source_language + "-" +
+                                 config.target_language + ": " + entry.error);
+    }
+    return entry.translator;
+}
+
+void ModelRegistry::add(const ModelConfig &config) {
+    register_entry(config);
+}
+
+std::shared_ptr<const Translator> ModelRegistry::get(const std::string &source, const std::string &target) {
+    return load(*find(source, target));
+}
+
+std::shared_ptr<const Translator> ModelRegistry::get(const ModelConfig &config) {
+    return load(*register_entry(config));
+}
+
+ModelState ModelRegistry::state(const std::string &source, const std::string &target) {
+    return find(source, target)->state;
+}
+
+std::string ModelRegistry::error(const std::string &source, const std::string &target) {
+    std::shared_ptr<Entry> entry = find(source, target);
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    return entry->error;
+}
+
+size_t ModelRegistry::preload() {
+    std::vector<std::shared_ptr<Entry>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = order;
+    }
+
+    size_t failed = 0;
+    for (const std::shared_ptr<Entry> &entry : pending) {
+        try {
+            load(*entry);
+        } catch (const std::runtime_error &) {
+            ++failed;
+        }
+    }
+    return failed;
+}
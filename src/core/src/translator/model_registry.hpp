@@ -0,0 +1,158 @@
+#pragma once
+
+#include "traslator.hpp"
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Описание модели одного направления перевода.
+ */
+struct ModelConfig {
+    std::string source_language;        ///< Код исходного языка ("en").
+    std::string target_language;        ///< Код языка перевода ("ru").
+    std::string vocab_path;             ///< Путь к словарю.
+    std::string encoder_path;           ///< Путь к ONNX-модели энкодера.
+    std::string decoder_path;           ///< Путь к ONNX-модели декодера.
+    std::string decoder_with_past_path; ///< Путь к декодеру с кешем (может быть пустым).
+    int pad_token_id = 62517;           ///< Токен заполнения моделей opus-mt.
+    int eos_token_id = 0;               ///< Токен конца последовательности моделей opus-mt.
+    int beam_width = 3;                 ///< Количество лучей.
+    RuntimeOptions runtime_options;     ///< Потоки и память ONNX Runtime.
+
+    /**
+     * @brief Описание модели, экспортированной export_to_onnx.py в каталог.
+     * @param source Код исходного языка.
+     * @param target Код языка перевода.
+     * @param directory Каталог с vocab.json, encoder.onnx, decoder.onnx и decoder_with_past.onnx.
+     *
+     * decoder_with_past.onnx необязателен: в старых экспортах его нет, и тогда
+     * переводчик на каждом шаге декодирует весь префикс.
+     *
+     * Пример:
+     *   ModelConfig config = ModelConfig::from_directory("en", "ru", "../core/opus-mt-en-ru");
+     */
+    static ModelConfig from_directory(const std::string &source, const std::string &target,
+                                      const std::string &directory) {
+        ModelConfig config;
+        config.source_language = source;
+        config.target_language = target;
+        config.vocab_path = directory + "/vocab.json";
+        config.encoder_path = directory + "/encoder.onnx";
+        config.decoder_path = directory + "/decoder.onnx";
+        std::string past_path = directory + "/decoder_with_past.onnx";
+        if (std::ifstream(past_path).is_open())
+            config.decoder_with_past_path = past_path;
+        return config;
+    }
+};
+
+/**
+ * @brief Состояние загрузки модели в реестре.
+ */
+enum class ModelState {
+    NotLoaded, ///< Модель зарегистрирована, но ещё не загружалась.
+    Loading,   ///< Модель загружается.
+    Ready,     ///< Модель загружена, сессии прогреты.
+    Failed     ///< Последняя загрузка завершилась ошибкой.
+};
+
+/**
+ * @brief Реестр загруженных переводчиков по направлениям перевода.
+ *
+ * Каждая модель, адресуемая направлением и путём к энкодеру, загружается один
+ * раз; все вызывающие (GUI, CLI, сервер) получают разделяемый указатель на
+ * тот же Translator, и сессии ONNX Runtime не пересоздаются. Translator::run
+ * константен, поэтому одним экземпляром можно переводить из разных потоков. Разные модели
+ * загружаются независимо: загрузка одной не блокирует выдачу другой.
+ *
+ * Пример:
+ *   ModelRegistry &registry = ModelRegistry::instance();
+ *   registry.add(ModelConfig::from_directory("en", "ru", "../core/opus-mt-en-ru"));
+ *   registry.preload();
+ *   std::shared_ptr<const Translator> translator = registry.get("en", "ru");
+ */
+class ModelRegistry {
+public:
+    /**
+     * @brief Возвращает общий для процесса реестр.
+     */
+    static ModelRegistry &instance();
+
+    /**
+     * @brief Регистрирует модель без загрузки.
+     * @param config Описание модели; повторная регистрация той же модели игнорируется.
+     */
+    void add(const ModelConfig &config);
+
+    /**
+     * @brief Возвращает переводчик направления, загружая его при первом обращении.
+     * @param source Код исходного языка.
+     * @param target Код языка перевода.
+     * @return Разделяемый переводчик первой зарегистрированной модели направления.
+     * @throws std::out_of_range Если для направления не зарегистрировано моделей.
+     * @throws std::runtime_error Если модель не удалось загрузить.
+     */
+    std::shared_ptr<const Translator> get(const std::string &source, const std::string &target);
+
+    /**
+     * @brief Регистрирует модель (если нужно) и возвращает её переводчик.
+     * @param config Описание модели.
+     * @throws std::runtime_error Если модель не удалось загрузить.
+     */
+    std::shared_ptr<const Translator> get(const ModelConfig &config);
+
+    /**
+     * @brief Возвращает состояние загрузки модели направления.
+     * @throws std::out_of_range Если для направления не зарегистрировано моделей.
+     */
+    ModelState state(const std::string &source, const std::string &target);
+
+    /**
+     * @brief Возвращает текст ошибки последней загрузки модели направления.
+     * @return Сообщение исключения, пустая строка — если загрузка не завершалась ошибкой.
+     * @throws std::out_of_range Если для направления не зарегистрировано моделей.
+     *
+     * Пример:
+     *   if (registry.state("en", "ru") == ModelState::Failed)
+     *       std::cerr << registry.error("en", "ru") << std::endl;
+     */
+    std::string error(const std::string &source, const std::string &target);
+
+    /**
+     * @brief Загружает все зарегистрированные модели.
+     * @return Количество моделей, которые не удалось загрузить (их состояние — Failed).
+     *
+     * Обычно вызывается при запуске приложения, в том числе из фонового потока,
+     * чтобы первый перевод не ждал загрузки моделей.
+     */
+    size_t preload();
+
+private:
+    using Key = std::tuple<std::string, std::string, std::string>; ///< Направление и путь к энкодеру.
+
+    /**
+     * @brief Зарегистрированная модель.
+     */
+    struct Entry {
+        ModelConfig config;                            ///< Описание модели.
+        std::mutex mutex;                              ///< Сериализует загрузку модели.
+        std::atomic<ModelState> state{ModelState::NotLoaded}; ///< Состояние загрузки.
+        std::shared_ptr<const Translator> translator;  ///< Загруженный переводчик.
+        std::string error;                             ///< Ошибка последней загрузки.
+    };
+
+    std::mutex mutex;                                  ///< Защищает entries и order.
+    std::map<Key, std::shared_ptr<Entry>> entries;     ///< Зарегистрированные модели.
+    std::vector<std::shared_ptr<Entry>> order;         ///< Модели в порядке регистрации.
+
+    static Key key(const ModelConfig &config);
+    std::shared_ptr<Entry> register_entry(const ModelConfig &config);
+    std::shared_ptr<Entry> find(const std::string &source, const std::string &target);
+    static std::shared_ptr<const Translator> load(Entry &entry);
+};
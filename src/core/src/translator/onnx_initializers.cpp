@@ -0,0 +1,205 @@
+#include "onnx_initializers.hpp"
+#include "../tokenizer/mapped_file.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Типы полей формата protobuf.
+constexpr uint32_t kVarint = 0;
+constexpr uint32_t kFixed64 = 1;
+constexpr uint32_t kLengthDelimited = 2;
+constexpr uint32_t kFixed32 = 5;
+
+// Номера полей onnx.proto.
+constexpr uint32_t kModelGraph = 7;
+constexpr uint32_t kGraphInitializer = 5;
+constexpr uint32_t kTensorDims = 1;
+constexpr uint32_t kTensorDataType = 2;
+constexpr uint32_t kTensorName = 8;
+constexpr uint32_t kTensorRawData = 9;
+constexpr uint32_t kTensorDataLocation = 14;
+constexpr uint64_t kDataLocationExternal = 1;
+
+[[noreturn]] void malformed() {
+    throw std::runtime_error("Malformed ONNX model");
+}
+
+// Последовательное чтение полей одного сообщения protobuf.
+class ProtoReader {
+public:
+    ProtoReader(const char *begin, const char *end) : position(begin), end(end) {}
+
+    bool done() const { return position == end; }
+    const char *data() const { return position; }
+    size_t size() const { return static_cast<size_t>(end - position); }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position == end)
+                malformed();
+            uint8_t byte = static_cast<uint8_t>(*position++);
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        malformed();
+    }
+
+    // Читает ключ следующего поля; false — сообщение закончилось.
+    bool next(uint32_t &field, uint32_t &wire_type) {
+        if (done())
+            return false;
+        uint64_t key = varint();
+        field = static_cast<uint32_t>(key >> 3);
+        wire_type = static_cast<uint32_t>(key & 7);
+        return true;
+    }
+
+    // Содержимое поля kLengthDelimited.
+    ProtoReader bytes() {
+        uint64_t length = varint();
+        if (length > size())
+            malformed();
+        ProtoReader nested(position, position + length);
+        position += length;
+        return nested;
+    }
+
+    void skip(uint32_t wire_type) {
+        switch (wire_type) {
+        case kVarint:
+            varint();
+            return;
+        case kFixed64:
+            advance(8);
+            return;
+        case kLengthDelimited:
+            bytes();
+            return;
+        case kFixed32:
+            advance(4);
+            return;
+        default:
+            malformed();
+        }
+    }
+
+private:
+    const char *position;
+    const char *end;
+
+    void advance(size_t count) {
+        if (count > size())
+            malformed();
+        position += count;
+    }
+};
+
+// Размер элемента для числовых типов TensorProto.DataType; 0 — тип не поддерживается.
+size_t element_size(int32_t data_type) {
+    switch (data_type) {
+    case 2:  // UINT8
+    case 3:  // INT8
+    case 9:  // BOOL
+        return 1;
+    case 4:  // UINT16
+    case 5:  // INT16
+    case 10: // FLOAT16
+    case 16: // BFLOAT16
+        return 2;
+    case 1:  // FLOAT
+    case 6:  // INT32
+    case 12: // UINT32
+        return 4;
+    case 7:  // INT64
+    case 11: // DOUBLE
+    case 13: // UINT64
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Разбирает TensorProto; false — данные тензора хранятся не в raw_data.
+bool read_tensor(ProtoReader tensor, OnnxInitializer &initializer) {
+    ProtoReader raw(nullptr, nullptr);
+    bool has_raw = false;
+    bool external = false;
+
+    uint32_t field, wire_type;
+    while (tensor.next(field, wire_type)) {
+        if (field == kTensorDims && wire_type == kVarint) {
+            initializer.dims.push_back(static_cast<int64_t>(tensor.varint()));
+        } else if (field == kTensorDims && wire_type == kLengthDelimited) {
+            for (ProtoReader packed = tensor.bytes(); !packed.done();)
+                initializer.dims.push_back(static_cast<int64_t>(packed.varint()));
+        } else if (field == kTensorDataType && wire_type == kVarint) {
+            initializer.data_type = static_cast<int32_t>(tensor.varint());
+        } else if (field == kTensorName && wire_type == kLengthDelimited) {
+            ProtoReader name = tensor.bytes();
+            initializer.name.assign(name.data(), name.size());
+        } else if (field == kTensorRawData && wire_type == kLengthDelimited) {
+            raw = tensor.bytes();
+            has_raw = true;
+        } else if (field == kTensorDataLocation && wire_type == kVarint) {
+            external = tensor.varint() == kDataLocationExternal;
+        } else {
+            tensor.skip(wire_type);
+        }
+    }
+
+    size_t item_size = element_size(initializer.data_type);
+    if (!has_raw || external || item_size == 0 || initializer.name.empty())
+        return false;
+
+    size_t count = 1;
+    for (int64_t d : initializer.dims) {
+        if (d < 0)
+            malformed();
+        count *= static_cast<size_t>(d);
+    }
+    if (count * item_size != raw.size())
+        malformed();
+
+    initializer.size = raw.size();
+    initializer.data.reset(new char[raw.size()]);
+    std::copy(raw.data(), raw.data() + raw.size(), initializer.data.get());
+    return true;
+}
+
+} // namespace
+
+std::vector<OnnxInitializer> read_onnx_initializers(const char *data, size_t size) {
+    std::vector<OnnxInitializer> initializers;
+    ProtoReader model(data, data + size);
+    uint32_t field, wire_type;
+    while (model.next(field, wire_type)) {
+        if (field != kModelGraph || wire_type != kLengthDelimited) {
+            model.skip(wire_type);
+            continue;
+        }
+        ProtoReader graph = model.bytes();
+        while (graph.next(field, wire_type)) {
+            if (field != kGraphInitializer || wire_type != kLengthDelimited) {
+                graph.skip(wire_type);
+                continue;
+            }
+            OnnxInitializer initializer;
+            if (read_tensor(graph.bytes(), initializer))
+                initializers.push_back(std::move(initializer));
+        }
+    }
+    return initializers;
+}
+
+std::vector<OnnxInitializer> read_onnx_initializers(const std::string &path) {
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(path);
+    } catch (const std::runtime_error &) {
+        throw std::runtime_error("Failed to open ONNX model: " + path);
+    }
+    return read_onnx_initializers(file->data(), file->size());
+}
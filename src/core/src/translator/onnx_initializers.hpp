@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Вес (initializer) графа ONNX-модели, скопированный в память процесса.
+ */
+struct OnnxInitializer {
+    std::string name;             ///< Имя initializer в графе.
+    int32_t data_type = 0;        ///< TensorProto.DataType; совпадает с ONNXTensorElementDataType.
+    std::vector<int64_t> dims;    ///< Форма тензора.
+    std::unique_ptr<char[]> data; ///< Данные тензора (выровнены как при new).
+    size_t size = 0;              ///< Размер data в байтах.
+};
+
+/**
+ * @brief Читает веса графа ONNX-модели, хранящиеся в raw_data.
+ * @param path Путь к файлу .onnx.
+ * @return Веса в порядке графа. Тензоры с данными вне raw_data (типизированные
+ *         поля, внешние файлы, строки) пропускаются: их загружает сама сессия.
+ * @throws std::runtime_error Если файл не удалось открыть или он не является
+ *         корректной моделью ONNX.
+ *
+ * Разбирает только поля ModelProto.graph, GraphProto.initializer и нужные поля
+ * TensorProto, без зависимости от protobuf. Прочитанные веса передаются всем
+ * репликам сессий через Ort::SessionOptions::AddInitializer, чтобы реплики
+ * разделяли один экземпляр весов.
+ *
+ * Пример:
+ *   std::vector<OnnxInitializer> weights = read_onnx_initializers("decoder.onnx");
+ */
+std::vector<OnnxInitializer> read_onnx_initializers(const std::string &path);
+
+/**
+ * @brief Вариант read_onnx_initializers для модели, уже находящейся в памяти.
+ * @param data Сериализованный ModelProto.
+ * @param size Размер data в байтах.
+ * @throws std::runtime_error Если данные не являются корректной моделью ONNX.
+ */
+std::vector<OnnxInitializer> read_onnx_initializers(const char *data, size_t size);
@@ -0,0 +1,52 @@
+#include "runtime_options.hpp"
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+std::mutex environment_mutex;
+std::unique_ptr<Ort::Env> environment;
+bool environment_has_global_pools = false;
+
+} // namespace
+
+Ort::Env &shared_environment(const RuntimeOptions &options) {
+    std::lock_guard<std::mutex> lock(environment_mutex);
+    if (!environment) {
+        if (options.global_thread_pools) {
+            Ort::ThreadingOptions threading;
+            threading.SetGlobalIntraOpNumThreads(options.intra_op_threads);
+            threading.SetGlobalInterOpNumThreads(options.inter_op_threads);
+            threading.SetGlobalSpinControl(options.allow_spinning ? 1 : 0);
+            environment = std::make_unique<Ort::Env>(threading, ORT_LOGGING_LEVEL_WARNING, "Translator");
+        } else {
+            environment = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "Translator");
+        }
+        environment_has_global_pools = options.global_thread_pools;
+    } else if (options.global_thread_pools && !environment_has_global_pools) {
+        throw std::runtime_error(
+            "ONNX Runtime environment was already created without global thread pools");
+    }
+    return *environment;
+}
+
+Ort::SessionOptions make_session_options(const RuntimeOptions &options) {
+    Ort::SessionOptions session_options;
+    session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+    session_options.SetExecutionMode(options.parallel_execution ? ORT_PARALLEL : ORT_SEQUENTIAL);
+    if (!options.cpu_arena)
+        session_options.DisableCpuMemArena();
+
+    if (options.global_thread_pools) {
+        // Число потоков и активное ожидание заданы пулами окружения.
+        session_options.DisablePerSessionThreads();
+    } else {
+        const char *spinning = options.allow_spinning ? "1" : "0";
+        session_options.SetIntraOpNumThreads(options.intra_op_threads);
+        session_options.SetInterOpNumThreads(options.inter_op_threads);
+        session_options.AddConfigEntry("session.intra_op.allow_spinning", spinning);
+        session_options.AddConfigEntry("session.inter_op.allow_spinning", spinning);
+    }
+    return session_options;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <onnxruntime_cxx_api.h>
+
+/**
+ * @brief Параметры выполнения моделей ONNX Runtime.
+ *
+ * Задают потоки, режим выполнения, арену памяти и активное ожидание потоков
+ * для всех сессий переводчика. С global_thread_pools сессии не создают
+ * собственных пулов потоков, а используют общие пулы окружения процесса:
+ * загрузка нескольких языковых пар не умножает число потоков.
+ *
+ * Если одна сессия не успевает обслуживать параллельные переводы, модель
+ * загружается session_replicas раз. Веса моделей читаются один раз и передаются
+ * всем репликам через AddInitializer, а их предупакованные матрицы (GEMM)
+ * хранятся один раз в общем Ort::PrepackedWeightsContainer.
+ *
+ * Пример:
+ *   RuntimeOptions options = RuntimeOptions::global(8);
+ *   Translator translator(tokenizer, "encoder.onnx", "decoder.onnx", 0, 2, 50, 3,
+ *                         "decoder_with_past.onnx", options);
+ */
+struct RuntimeOptions {
+    int intra_op_threads = 1;         ///< Потоки внутри оператора (0 — по числу ядер).
+    int inter_op_threads = 1;         ///< Потоки между операторами (0 — по числу ядер).
+    bool parallel_execution = false;  ///< Выполнять независимые узлы графа параллельно (ORT_PARALLEL).
+    bool cpu_arena = true;            ///< Использовать арену памяти CPU.
+    bool allow_spinning = true;       ///< Разрешить активное ожидание потоков между задачами.
+    bool global_thread_pools = false; ///< Использовать общие пулы потоков окружения процесса.
+    int session_replicas = 1;         ///< Реплик сессий на модель; веса и их предупакованные копии общие.
+
+    /**
+     * @brief Параметры с общими пулами потоков для всех сессий процесса.
+     * @param threads Число потоков внутри оператора (0 — по числу ядер).
+     */
+    static RuntimeOptions global(int threads = 0) {
+        RuntimeOptions options;
+        options.intra_op_threads = threads;
+        options.global_thread_pools = true;
+        return options;
+    }
+};
+
+/**
+ * @brief Возвращает окружение ONNX Runtime, общее для всего процесса.
+ * @param options Параметры; пулы потоков окружения создаются по параметрам
+ *        первого вызова с global_thread_pools.
+ * @return Окружение, живущее до завершения процесса.
+ * @throws std::runtime_error Если общие пулы запрошены после того, как
+ *         окружение уже создано без них.
+ *
+ * ONNX Runtime допускает одно окружение на процесс, поэтому все сессии
+ * переводчиков создаются в нём.
+ */
+Ort::Env &shared_environment(const RuntimeOptions &options);
+
+/**
+ * @brief Создаёт опции сессии по параметрам выполнения.
+ * @param options Параметры выполнения.
+ * @return Опции с полной оптимизацией графа.
+ */
+Ort::SessionOptions make_session_options(const RuntimeOptions &options);
@@ -1,5 +1,7 @@
 #include "../tokenizer/tokenizer.hpp"
 #include "traslator.hpp"
+#include "beam_kernels.hpp"
+#include "beam_search.hpp"
 #include <algorithm>
 #include <array>
 #include <cmath>
@@ -8,154 +10,687 @@
 #include <numeric>
 #include <onnxruntime_c_api.h>
 #include <onnxruntime_cxx_api.h>
-#include <queue>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
-Translator::Translator(const Tokenizer tokenizer, const std::string &encoder_path,
+namespace {
+
+const std::string kPastPrefix = "past_key_values";
+const std::string kPresentPrefix = "present";
+const std::string kTopLogProbs = "top_log_probs";
+const std::string kTopTokenIds = "top_token_ids";
+
+bool starts_with(const std::string &name, const std::string &prefix) {
+    return name.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::vector<std::string> input_names(const Ort::Session &session,
+                                     Ort::AllocatorWithDefaultOptions &allocator) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < session.GetInputCount(); ++i)
+        names.emplace_back(session.GetInputNameAllocated(i, allocator).get());
+    return names;
+}
+
+std::vector<std::string> output_names(const Ort::Session &session,
+                                      Ort::AllocatorWithDefaultOptions &allocator) {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < session.GetOutputCount(); ++i)
+        names.emplace_back(session.GetOutputNameAllocated(i, allocator).get());
+    return names;
+}
+
+size_t element_count(const std::vector<int64_t> &shape) {
+    size_t count = 1;
+    for (int64_t d : shape)
+        count *= static_cast<size_t>(d);
+    return count;
+}
+
+// Тензоры над первыми 1..rows строками буфера: views[b - 1] имеет форму [b, shape[1:]...].
+template <class T>
+std::vector<Ort::Value> row_views(const Ort::MemoryInfo &memory_info, T *data, size_t rows,
+                                  std::vector<int64_t> shape) {
+    size_t row_size = 1;
+    for (size_t d = 1; d < shape.size(); ++d)
+        row_size *= static_cast<size_t>(shape[d]);
+
+    std::vector<Ort::Value> views;
+    views.reserve(rows);
+    for (size_t b = 1; b <= rows; ++b) {
+        shape[0] = static_cast<int64_t>(b);
+        views.push_back(
+            Ort::Value::CreateTensor<T>(memory_info, data, b * row_size, shape.data(), shape.size()));
+    }
+    return views;
+}
+
+} // namespace
+
+Translator::Translator(const Tokenizer &tokenizer, const std::string &encoder_path,
                       const std::string &decoder_path, int pad_token_id,
-                      int eos_token_id, int max_length, int beam_width)
-    : env(ORT_LOGGING_LEVEL_WARNING, "Translator"), session_options(),
-      encoder_session(nullptr), decoder_session(nullptr),
+                      int eos_token_id, int max_length, int beam_width,
+                      const std::string &decoder_with_past_path,
+                      const RuntimeOptions &runtime_options)
+    : env(shared_environment(runtime_options)),
+      share_weights(runtime_options.session_replicas > 1),
+      session_options(make_session_options(runtime_options)),
       pad_token_id(pad_token_id), eos_token_id(eos_token_id),
-      max_length(max_length), beam_width(beam_width), tokenizer(tokenizer) {
-    session_options.SetIntraOpNumThreads(1);
-    session_options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+      length_policy(LengthPolicy::fixed(max_length)), beam_width(beam_width),
+      tokenizer(tokenizer) {
+    replicas.push_back(create_replica(encoder_path, decoder_path, ""));
+    SessionReplica &primary = *replicas.front();
+    decoder_io = {input_names(primary.decoder, allocator), output_names(primary.decoder, allocator),
+                  {}, {}, {}};
+
+    const std::vector<std::string> &inputs = decoder_io.inputs;
+    merged_decoder = std::find(inputs.begin(), inputs.end(), "use_cache_branch") != inputs.end();
+
+    std::string past_path = merged_decoder ? "" : decoder_with_past_path;
+    if (!past_path.empty()) {
+        primary.decoder_with_past =
+            Ort::Session(env, past_path.c_str(), model_options(past_path), prepacked_weights);
+        decoder_with_past_io = {input_names(primary.decoder_with_past, allocator),
+                                output_names(primary.decoder_with_past, allocator), {}, {}, {}};
+    }
+
+    const DecoderIo &cached_io = merged_decoder ? decoder_io : decoder_with_past_io;
+    for (size_t i = 0; i < cached_io.inputs.size(); ++i) {
+        if (!starts_with(cached_io.inputs[i], kPastPrefix))
+            continue;
+        past_names.push_back(cached_io.inputs[i]);
+        // Кеш перекрёстного внимания (past_key_values.N.encoder.*) с шагами не растёт.
+        past_grows.push_back(cached_io.inputs[i].find(".encoder.") == std::string::npos);
+
+        // Первый шаг объединённого декодера получает кеш нулевой длины; размер пакета
+        // известен только в begin_decode.
+        if (merged_decoder)
+            empty_past_shapes.push_back(
+                primary.decoder.GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
+    }
+
+    // Без кеша декодеру нужны только логиты (или k лучших токенов, если модель
+    // экспортирована с головой TopK), с кешем — также present.*.
+    std::pair<DecoderIo *, Ort::Session *> decoders[] = {
+        {&decoder_io, &primary.decoder}, {&decoder_with_past_io, &primary.decoder_with_past}};
+    for (auto [io, session] : decoders) {
+        auto top_k_output = std::find(io->outputs.begin(), io->outputs.end(), kTopTokenIds);
+        io->top_k_head = top_k_output != io->outputs.end();
+        if (io->top_k_head) {
+            // Выбор beam_width продолжений из 2 * beam_width лучших совпадает с выбором
+            // по полным логитам, только если голова возвращает не меньше 2 * beam_width.
+            size_t index = top_k_output - io->outputs.begin();
+            io->top_k = session->GetOutputTypeInfo(index).GetTensorTypeAndShapeInfo().GetShape().back();
+            if (io->top_k <= 0)
+                throw std::runtime_error("Decoder TopK head must have a static k in the shape of " +
+                                         kTopTokenIds);
+            if (io->top_k < 2 * static_cast<int64_t>(beam_width))
+                throw std::runtime_error("Decoder TopK head returns " + std::to_string(io->top_k) +
+                                         " tokens, beam search needs at least " +
+                                         std::to_string(2 * beam_width));
+        }
+        for (const std::string &name : io->outputs) {
+            bool scores = io->top_k_head ? name == kTopLogProbs || name == kTopTokenIds
+                                         : name == "logits";
+            if (scores || (!past_names.empty() && past_index(name) >= 0)) {
+                io->fetched.push_back(name);
+                io->fetched_past.push_back(past_index(name));
+            }
+        }
+        for (const std::string &name : io->inputs)
+            io->input_past.push_back(past_index(name));
+    }
 
-    encoder_session = Ort::Session(env, encoder_path.c_str(), session_options);
-    decoder_session = Ort::Session(env, decoder_path.c_str(), session_options);
+    if (!merged_decoder && !past_names.empty()) {
+        size_t returned = std::count_if(decoder_io.outputs.begin(), decoder_io.outputs.end(),
+                                        [this](const std::string &name) { return past_index(name) >= 0; });
+        if (returned != past_names.size())
+            throw std::runtime_error(
+                "Decoder model does not return the past key values required by decoder_with_past");
+    }
+
+    for (size_t i = 0; i < decoder_io.outputs.size(); ++i)
+        if (decoder_io.outputs[i] == "logits")
+            vocab_size = primary.decoder.GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape().back();
+
+    // Остальные реплики используют веса, загруженные и предупакованные для первой.
+    for (int i = 1; i < runtime_options.session_replicas; ++i)
+        replicas.push_back(create_replica(encoder_path, decoder_path, past_path));
 }
 
-std::string Translator::run(const std::string &input) {
-    std::vector<int64_t> input_ids = tokenizer.encode(input);
-    std::vector<int64_t> attention_mask(input_ids.size(), 1);
-    std::vector<float> encoder_hidden = encode_input(input_ids);
+std::unique_ptr<Translator::SessionReplica>
+Translator::create_replica(const std::string &encoder_path, const std::string &decoder_path,
+                           const std::string &decoder_with_past_path) {
+    auto replica = std::make_unique<SessionReplica>();
+    replica->encoder =
+        Ort::Session(env, encoder_path.c_str(), model_options(encoder_path), prepacked_weights);
+    replica->decoder =
+        Ort::Session(env, decoder_path.c_str(), model_options(decoder_path), prepacked_weights);
+    if (!decoder_with_past_path.empty())
+        replica->decoder_with_past = Ort::Session(env, decoder_with_past_path.c_str(),
+                                                  model_options(decoder_with_past_path),
+                                                  prepacked_weights);
+    return replica;
+}
 
-    std::priority_queue<Beam> beams;
-    beams.push({{pad_token_id}, 0.0f});
-    std::vector<Beam> completed_beams;
+const Ort::SessionOptions &Translator::model_options(const std::string &path) {
+    // С одной репликой веса загружает сама сессия: копия в процессе ничего не сэкономит.
+    if (!share_weights)
+        return session_options;
+
+    std::unique_ptr<SharedWeights> &weights = shared_weights[path];
+    if (!weights) {
+        weights = std::make_unique<SharedWeights>();
+        weights->initializers = read_onnx_initializers(path);
+        weights->options = session_options.Clone();
+        weights->values.reserve(weights->initializers.size());
+        for (OnnxInitializer &initializer : weights->initializers) {
+            weights->values.push_back(Ort::Value::CreateTensor(
+                memory_info, initializer.data.get(), initializer.size, initializer.dims.data(),
+                initializer.dims.size(), static_cast<ONNXTensorElementDataType>(initializer.data_type)));
+            weights->options.AddInitializer(initializer.name.c_str(), weights->values.back());
+        }
+    }
+    return weights->options;
+}
 
-    for (int step = 0; step < max_length; ++step) {
-        std::priority_queue<Beam> new_beams;
+Translator::ReplicaLease::ReplicaLease(const Translator &translator)
+    : replica(translator.checkout()), translator(translator) {}
 
-        while (!beams.empty()) {
-            Beam beam = beams.top();
-            beams.pop();
+Translator::ReplicaLease::~ReplicaLease() {
+    translator.release(replica);
+}
 
-            if (!beam.tokens.empty() && beam.tokens.back() == eos_token_id) {
-                completed_beams.push_back(beam);
-                continue;
+Translator::SessionReplica &Translator::checkout() const {
+    for (;;) {
+        SessionReplica *best = replicas.front().get();
+        size_t best_active = best->active.load(std::memory_order_relaxed);
+        for (const std::unique_ptr<SessionReplica> &replica : replicas) {
+            size_t active = replica->active.load(std::memory_order_relaxed);
+            if (active < best_active) {
+                best = replica.get();
+                best_active = active;
             }
+        }
+        if (!best->active.compare_exchange_weak(best_active, best_active + 1))
+            continue;
+
+        ++best->checkouts;
+        size_t total = active_total.fetch_add(1) + 1;
+        size_t peak = peak_active.load(std::memory_order_relaxed);
+        while (total > peak && !peak_active.compare_exchange_weak(peak, total))
+            ;
+        return *best;
+    }
+}
+
+void Translator::release(SessionReplica &replica) const {
+    --replica.active;
+    --active_total;
+}
+
+Translator::SessionPoolStats Translator::session_pool_stats() const {
+    SessionPoolStats stats;
+    stats.replicas = replicas.size();
+    stats.active = active_total.load();
+    stats.peak_active = peak_active.load();
+    for (const std::unique_ptr<SessionReplica> &replica : replicas) {
+        stats.checkouts += replica->checkouts.load();
+        stats.replica_active.push_back(replica->active.load());
+    }
+    return stats;
+}
 
-            std::vector<float> logits = decode_step(beam.tokens, attention_mask, encoder_hidden);
-            std::vector<float> probs = softmax(logits);
-            auto topk = top_k(probs, beam_width);
-
-            for (auto &[token_id, prob] : topk) {
-                Beam new_beam = beam;
-                new_beam.tokens.push_back(token_id);
-                new_beam.score += std::log(prob + 1e-8f);
-                new_beams.push(new_beam);
-                if ((int)new_beams.size() > beam_width) {
-                    std::priority_queue<Beam> tmp;
-                    while ((int)tmp.size() < beam_width && !new_beams.empty()) {
-                        tmp.push(new_beams.top());
-                        new_beams.pop();
-                    }
-                    new_beams = std::move(tmp);
-                }
-            }   
+std::string Translator::run(const std::string &input) const {
+    return translate_batch({input}).front();
+}
+
+std::vector<std::string> Translator::translate_batch(const std::vector<std::string> &inputs) const {
+    if (inputs.empty())
+        return {};
+
+    std::vector<std::vector<int64_t>> input_ids;
+    input_ids.reserve(inputs.size());
+    for (const std::string &input : inputs)
+        input_ids.push_back(tokenizer.encode(input));
+
+    // Для частых ширин луча используются специализации с состоянием фиксированного размера.
+    switch (beam_width) {
+    case 1:
+        return generate<GreedySearch>(input_ids);
+    case 2:
+        return generate<FixedBeamSearch<2>>(input_ids);
+    case 3:
+        return generate<FixedBeamSearch<3>>(input_ids);
+    case 4:
+        return generate<FixedBeamSearch<4>>(input_ids);
+    case 5:
+        return generate<FixedBeamSearch<5>>(input_ids);
+    default:
+        return generate<BeamSearch>(input_ids);
+    }
+}
+
+template <class Search>
+std::vector<std::string>
+Translator::generate(const std::vector<std::vector<int64_t>> &input_ids) const {
+    size_t count = input_ids.size();
+    std::vector<int> budgets(count);
+    for (size_t n = 0; n < count; ++n)
+        budgets[n] = length_policy.budget(input_ids[n].size());
+    int max_length = *std::max_element(budgets.begin(), budgets.end());
+
+    ReplicaLease lease(*this);
+    RequestContext context;
+    context.replica = &lease.replica;
+    begin_decode(context, input_ids, max_length);
+
+    std::vector<Search> searches(count);
+    for (size_t n = 0; n < count; ++n)
+        searches[n].reset(pad_token_id, beam_width, budgets[n], beam_options);
+
+    size_t capacity = count * beam_width;
+    std::vector<size_t> active, offsets(count), layout, parents;
+    active.reserve(count);
+    layout.reserve(capacity);
+    parents.reserve(capacity);
+
+    for (int step = 0; step < max_length; ++step) {
+        // Строки пакета — живые гипотезы незавершённых фраз подряд; завершённые фразы выбывают.
+        active.clear();
+        layout.clear();
+        for (size_t n = 0; n < count; ++n) {
+            if (searches[n].done() || step >= budgets[n])
+                continue;
+            active.push_back(n);
+            offsets[n] = layout.size();
+            layout.insert(layout.end(), searches[n].live_count(), n);
+        }
+        if (active.empty())
+            break;
+        arrange_rows(context, layout);
+
+        // Все живые гипотезы имеют одинаковую длину и декодируются одним пакетом [rows, t].
+        size_t batch_size = layout.size();
+        size_t sequence_length = 1;
+        for (size_t n : active) {
+            const Search &search = searches[n];
+            if (context.past.empty()) {
+                sequence_length = search.length();
+                for (size_t b = 0; b < search.live_count(); ++b)
+                    search.prefix(b, context.decoder_ids.data() + (offsets[n] + b) * sequence_length);
+            } else {
+                std::copy(search.last_tokens(), search.last_tokens() + search.live_count(),
+                          context.decoder_ids.begin() + offsets[n]);
             }
         }
 
-        if (new_beams.empty())
-            break;
+        decode_step(context, batch_size, sequence_length);
+
+        parents.clear();
+        for (size_t n : active) {
+            Search &search = searches[n];
+            size_t row = offsets[n] * context.step_width;
+            if (context.step_tokens)
+                search.step_top_k(context.step_scores + row, context.step_tokens + row,
+                                  context.step_width, eos_token_id);
+            else
+                search.step(context.step_scores + row, context.step_width, eos_token_id);
+
+            if (!search.done() && step + 1 < budgets[n])
+                for (size_t b = 0; b < search.live_count(); ++b)
+                    parents.push_back(offsets[n] + search.parents()[b]);
+        }
 
-        beams = new_beams;
+        if (!context.past.empty() && !parents.empty())
+            reorder_past(context.past, parents.data(), parents.size());
     }
 
-    Beam best;
-    if (!completed_beams.empty()) {
-        best = *std::max_element(completed_beams.begin(), completed_beams.end(),
-                            [](const Beam &a, const Beam &b) { return a.score < b.score; });
-    } else if (!beams.empty()) {
-        best = beams.top();
-    } else {
-        return "";
-    }
+    std::vector<std::string> translations(count);
+    std::vector<int64_t> best;
+    for (size_t n = 0; n < count; ++n)
+        if (searches[n].best(best))
+            translations[n] = tokenizer.decode(best);
+    return translations;
+}
 
-    return tokenizer.decode(best.tokens);
+void Translator::set_length_policy(const LengthPolicy &policy) {
+    length_policy = policy;
 }
 
-std::vector<float> Translator::encode_input(const std::vector<int64_t> &input_ids) {
-    std::vector<int64_t> attention_mask(input_ids.size(), 1);
-    std::array<int64_t, 2> input_shape{1, (int64_t)input_ids.size()};
+void Translator::set_beam_options(const BeamSearchOptions &options) {
+    beam_options = options;
+}
 
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+Ort::Value Translator::encode_input(Ort::Session &encoder, std::vector<int64_t> &input_ids,
+                                    std::vector<int64_t> &attention_mask, size_t batch_size) const {
+    std::array<int64_t, 2> input_shape{static_cast<int64_t>(batch_size),
+                                       static_cast<int64_t>(input_ids.size() / batch_size)};
 
     Ort::Value input_tensor = Ort::Value::CreateTensor<int64_t>(
-        memory_info, const_cast<int64_t *>(input_ids.data()), input_ids.size(),
-        input_shape.data(), 2);
+        memory_info, input_ids.data(), input_ids.size(), input_shape.data(), 2);
 
     Ort::Value mask_tensor = Ort::Value::CreateTensor<int64_t>(
-        memory_info, attention_mask.data(), attention_mask.size(),
-        input_shape.data(), 2);
+        memory_info, attention_mask.data(), attention_mask.size(), input_shape.data(), 2);
 
     const char *input_names[] = {"input_ids", "attention_mask"};
     const char *output_names[] = {"last_hidden_state"};
 
     std::array<Ort::Value, 2> inputs = {std::move(input_tensor), std::move(mask_tensor)};
 
-    auto output_tensors = encoder_session.Run(Ort::RunOptions{nullptr}, input_names, inputs.data(),
-                                             inputs.size(), output_names, 1);
-
-    float *output_data = output_tensors.front().GetTensorMutableData<float>();
-    size_t size = output_tensors.front().GetTensorTypeAndShapeInfo().GetElementCount();
-
-    return std::vector<float>(output_data, output_data + size);
+    auto output_tensors = encoder.Run(Ort::RunOptions{nullptr}, input_names, inputs.data(),
+                                      inputs.size(), output_names, 1);
+    return std::move(output_tensors.front());
 }
 
-std::vector<float> Translator::decode_step(const std::vector<int64_t> &input_ids,
-                                     const std::vector<int64_t> &encoder_input_ids,
-                                     const std::vector<float> &encoder_hidden_state) {
-    std::array<int64_t, 2> dec_shape{1, static_cast<int64_t>(input_ids.size())};
-    std::array<int64_t, 2> enc_mask_shape{1, static_cast<int64_t>(encoder_input_ids.size())};
-    std::array<int64_t, 3> enc_hidden_shape{1, static_cast<int64_t>(encoder_input_ids.size()),
-                                       static_cast<int64_t>(encoder_hidden_state.size() /
-                                                            encoder_input_ids.size())};
-
-    Ort::MemoryInfo memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+void Translator::begin_decode(RequestContext &context,
+                              const std::vector<std::vector<int64_t>> &input_ids,
+                              int max_length) const {
+    size_t count = input_ids.size();
+    size_t rows = count * beam_width;
+    size_t source_length = 0;
+    for (const std::vector<int64_t> &ids : input_ids)
+        source_length = std::max(source_length, ids.size());
+
+    // Фразы дополняются pad_token_id до общей длины; маска исключает дополнение.
+    std::vector<int64_t> padded(count * source_length, pad_token_id);
+    context.source_mask.assign(count * source_length, 0);
+    for (size_t n = 0; n < count; ++n) {
+        std::copy(input_ids[n].begin(), input_ids[n].end(), padded.begin() + n * source_length);
+        std::fill_n(context.source_mask.begin() + n * source_length, input_ids[n].size(), 1);
+    }
 
-    Ort::Value dec_input = Ort::Value::CreateTensor<int64_t>(
-        memory_info, const_cast<int64_t *>(input_ids.data()), input_ids.size(),
-        dec_shape.data(), 2);
+    Ort::Value hidden = encode_input(context.replica->encoder, padded, context.source_mask, count);
+    std::vector<int64_t> hidden_shape = hidden.GetTensorTypeAndShapeInfo().GetShape();
+    context.source_length = source_length;
+    context.hidden_size = static_cast<size_t>(hidden_shape[2]);
+
+    context.encoder_mask.resize(rows * source_length);
+    if (rows == 1) {
+        // Одна фраза без лучей: выход энкодера используется без копирования.
+        context.encoder_hidden = std::move(hidden);
+        context.encoder_mask = context.source_mask;
+        context.row_sentences.assign(1, 0);
+    } else {
+        std::array<int64_t, 3> shape{static_cast<int64_t>(rows), hidden_shape[1], hidden_shape[2]};
+        context.encoder_hidden = Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size());
+        context.encoder_output = std::move(hidden);
+        context.row_sentences.assign(rows, count);
+
+        // Каждой фразе — beam_width подряд идущих строк; для одной фразы раскладка больше не меняется.
+        std::vector<size_t> layout(rows);
+        for (size_t row = 0; row < rows; ++row)
+            layout[row] = row / beam_width;
+        arrange_rows(context, layout);
+    }
+    context.hidden_views = row_views(memory_info, context.encoder_hidden.GetTensorMutableData<float>(),
+                                     rows, hidden_shape);
+    context.mask_views = row_views(memory_info, context.encoder_mask.data(), rows,
+                                   {1, static_cast<int64_t>(source_length)});
+
+    context.decoder_ids.assign(rows * (max_length + 1), pad_token_id);
+    std::array<int64_t, 1> flag_shape{1};
+    context.cache_flag = Ort::Value::CreateTensor<bool>(memory_info, &context.use_cache_branch, 1,
+                                                        flag_shape.data(), flag_shape.size());
+
+    context.decoder_binding = Ort::IoBinding(context.replica->decoder);
+    if (!past_names.empty()) {
+        // С кешем каждый шаг получает один токен на луч и возвращает логиты одной позиции.
+        context.ids_views = row_views(memory_info, context.decoder_ids.data(), rows, {1, 1});
+        if (vocab_size > 0) {
+            std::array<int64_t, 3> shape{static_cast<int64_t>(rows), 1, vocab_size};
+            context.logits_buffer = Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size());
+            context.logits_views = row_views(memory_info, context.logits_buffer.GetTensorMutableData<float>(),
+                                             rows, {1, 1, vocab_size});
+        }
+        const DecoderIo &cached_io = merged_decoder ? decoder_io : decoder_with_past_io;
+        if (cached_io.top_k_head) {
+            context.top_log_probs.resize(rows * cached_io.top_k);
+            context.top_token_ids.resize(rows * cached_io.top_k);
+            context.top_log_probs_views = row_views(memory_info, context.top_log_probs.data(), rows,
+                                                    {1, cached_io.top_k});
+            context.top_token_ids_views = row_views(memory_info, context.top_token_ids.data(), rows,
+                                                    {1, cached_io.top_k});
+        }
+        if (!merged_decoder)
+            context.decoder_with_past_binding = Ort::IoBinding(context.replica->decoder_with_past);
+        for (size_t i = 0; i < past_names.size(); ++i) {
+            context.past_views.emplace_back(nullptr);
+            context.present_views.emplace_back(nullptr);
+        }
 
-    Ort::Value enc_mask = Ort::Value::CreateTensor<int64_t>(
-        memory_info, const_cast<int64_t *>(encoder_input_ids.data()),
-        encoder_input_ids.size(), enc_mask_shape.data(), 2);
+        // На первом шаге у каждой фразы одна гипотеза: пакет из count строк.
+        context.empty_past.clear();
+        for (std::vector<int64_t> shape : empty_past_shapes) {
+            for (size_t d = 0; d < shape.size(); ++d)
+                if (shape[d] < 0)
+                    shape[d] = d == 0 ? static_cast<int64_t>(count) : 0;
+            context.empty_past.push_back(
+                Ort::Value::CreateTensor<float>(allocator, shape.data(), shape.size()));
+        }
+    } else {
+        context.logits.reserve(rows * std::max<int64_t>(vocab_size, 0));
+    }
+}
 
-    Ort::Value enc_hidden = Ort::Value::CreateTensor<float>(
-        memory_info, const_cast<float *>(encoder_hidden_state.data()),
-        encoder_hidden_state.size(), enc_hidden_shape.data(),
-        enc_hidden_shape.size());
+void Translator::arrange_rows(RequestContext &context, const std::vector<size_t> &layout) const {
+    // Если нужные строки уже стоят в начале буферов, копировать нечего. Так всегда
+    // при одной фразе; при нескольких строки переставляются, только когда меняется
+    // число гипотез какой-либо фразы.
+    if (std::equal(layout.begin(), layout.end(), context.row_sentences.begin()))
+        return;
+
+    size_t hidden_row = context.source_length * context.hidden_size;
+    const float *source = context.encoder_output.GetTensorData<float>();
+    float *target = context.encoder_hidden.GetTensorMutableData<float>();
+    for (size_t row = 0; row < layout.size(); ++row) {
+        size_t n = layout[row];
+        std::copy(source + n * hidden_row, source + (n + 1) * hidden_row, target + row * hidden_row);
+        std::copy(context.source_mask.begin() + n * context.source_length,
+                  context.source_mask.begin() + (n + 1) * context.source_length,
+                  context.encoder_mask.begin() + row * context.source_length);
+        context.row_sentences[row] = n;
+    }
+}
 
-    const char *input_names[] = {"encoder_attention_mask", "input_ids", "encoder_hidden_states"};
-    const char *output_names[] = {"logits"};
+void Translator::decode_step(RequestContext &context, size_t batch_size,
+                             size_t sequence_length) const {
+    bool use_cache = !past_names.empty();
+    bool first_step = context.past.empty();
+    bool use_past_session = use_cache && !merged_decoder && !first_step;
+    Ort::Session &session =
+        use_past_session ? context.replica->decoder_with_past : context.replica->decoder;
+    Ort::IoBinding &binding =
+        use_past_session ? context.decoder_with_past_binding : context.decoder_binding;
+    const DecoderIo &io = use_past_session ? decoder_with_past_io : decoder_io;
+    context.use_cache_branch = !first_step;
+
+    // Без кеша длина префикса растёт с каждым шагом, и тензор токенов создаётся заново.
+    Ort::Value prefix_ids{nullptr};
+    if (sequence_length != 1 || context.ids_views.empty()) {
+        std::array<int64_t, 2> shape{static_cast<int64_t>(batch_size),
+                                     static_cast<int64_t>(sequence_length)};
+        prefix_ids = Ort::Value::CreateTensor<int64_t>(memory_info, context.decoder_ids.data(),
+                                                       batch_size * sequence_length, shape.data(),
+                                                       shape.size());
+    }
+    const Ort::Value &ids = prefix_ids ? prefix_ids : context.ids_views[batch_size - 1];
+
+    // Из буферов энкодера используются первые batch_size строк.
+    for (size_t i = 0; i < io.inputs.size(); ++i) {
+        const std::string &name = io.inputs[i];
+        int index = io.input_past[i];
+        if (name == "input_ids") {
+            binding.BindInput(name.c_str(), ids);
+        } else if (name == "encoder_attention_mask") {
+            binding.BindInput(name.c_str(), context.mask_views[batch_size - 1]);
+        } else if (name == "encoder_hidden_states") {
+            binding.BindInput(name.c_str(), context.hidden_views[batch_size - 1]);
+        } else if (name == "use_cache_branch") {
+            binding.BindInput(name.c_str(), context.cache_flag);
+        } else if (index < 0) {
+            throw std::runtime_error("Unsupported decoder input: " + name);
+        } else if (first_step) {
+            binding.BindInput(name.c_str(), context.empty_past[index]);
+        } else {
+            // Тензор над кешем пересоздаётся, только если изменились его буфер или форма.
+            CacheTensor &cache = context.past[index];
+            std::vector<float> &buffer = cache.buffers[cache.current];
+            if (cache.view_data != buffer.data() || cache.view_shape != cache.shape) {
+                context.past_views[index] = Ort::Value::CreateTensor<float>(
+                    memory_info, buffer.data(), buffer.size(), cache.shape.data(), cache.shape.size());
+                cache.view_data = buffer.data();
+                cache.view_shape = cache.shape;
+            }
+            binding.BindInput(name.c_str(), context.past_views[index]);
+        }
+    }
 
-    std::array<Ort::Value, 3> inputs = {std::move(enc_mask), std::move(dec_input), std::move(enc_hidden)};
+    // Кеш перекрёстного внимания после первого шага не меняется: его present.*
+    // не запрашиваются, и кеш остаётся в своём буфере.
+    auto fetched = [&](size_t i) {
+        int index = io.fetched_past[i];
+        return index < 0 || first_step || past_grows[index];
+    };
+
+    // С кешем все выходы, кроме present.* первого шага, пишутся в буферы контекста.
+    bool preallocated_logits = !io.top_k_head && sequence_length == 1 && !context.logits_views.empty();
+    const DecoderIo &cached_io = merged_decoder ? decoder_io : decoder_with_past_io;
+    bool preallocated_top_k = !context.top_log_probs_views.empty() && io.top_k_head &&
+                              io.top_k == cached_io.top_k;
+    bool fetch = false;
+    for (size_t i = 0; i < io.fetched.size(); ++i) {
+        const std::string &name = io.fetched[i];
+        int index = io.fetched_past[i];
+        if (!fetched(i))
+            continue;
+        if (name == "logits" && preallocated_logits) {
+            binding.BindOutput(name.c_str(), context.logits_views[batch_size - 1]);
+        } else if (name == kTopLogProbs && preallocated_top_k) {
+            binding.BindOutput(name.c_str(), context.top_log_probs_views[batch_size - 1]);
+        } else if (name == kTopTokenIds && preallocated_top_k) {
+            binding.BindOutput(name.c_str(), context.top_token_ids_views[batch_size - 1]);
+        } else if (index >= 0 && !first_step) {
+            // present.* — во второй буфер; до конца шага cache.shape описывает его.
+            CacheTensor &cache = context.past[index];
+            ++cache.shape[cache.shape.size() - 2];
+            std::vector<float> &buffer = cache.buffers[1 - cache.current];
+            buffer.resize(element_count(cache.shape));
+            context.present_views[index] = Ort::Value::CreateTensor<float>(
+                memory_info, buffer.data(), buffer.size(), cache.shape.data(), cache.shape.size());
+            binding.BindOutput(name.c_str(), context.present_views[index]);
+        } else {
+            binding.BindOutput(name.c_str(), memory_info);
+            fetch = true;
+        }
+    }
 
-    auto output_tensors = decoder_session.Run(Ort::RunOptions{nullptr}, input_names, inputs.data(),
-                                             inputs.size(), output_names, 1);
+    context.outputs.clear();
+    session.Run(Ort::RunOptions{nullptr}, binding);
+
+    if (!first_step)
+        for (size_t i = 0; i < io.fetched.size(); ++i)
+            if (int index = io.fetched_past[i]; index >= 0 && fetched(i))
+                context.past[index].current ^= 1;
+    if (use_cache && first_step)
+        context.past.resize(past_names.size());
+
+    context.step_tokens = nullptr;
+    if (preallocated_top_k) {
+        context.step_scores = context.top_log_probs.data();
+        context.step_tokens = context.top_token_ids.data();
+        context.step_width = static_cast<size_t>(io.top_k);
+    } else if (preallocated_logits) {
+        context.step_scores = context.logits_buffer.GetTensorData<float>();
+        context.step_width = static_cast<size_t>(vocab_size);
+    }
+    if (!fetch)
+        return;
+
+    // Выходы возвращаются в порядке привязки.
+    context.outputs = binding.GetOutputValues();
+    // Привязки объединённого декодера переиспользуются на следующих шагах, где
+    // present.* кеша перекрёстного внимания не запрашиваются.
+    if (merged_decoder && first_step)
+        binding.ClearBoundOutputs();
+    for (size_t i = 0, output = 0; i < io.fetched.size(); ++i) {
+        if (!fetched(i))
+            continue;
+        const Ort::Value &value = context.outputs[output++];
+        const std::string &name = io.fetched[i];
+        int index = io.fetched_past[i];
+        if (name == kTopLogProbs && !preallocated_top_k) {
+            context.step_scores = value.GetTensorData<float>();
+            context.step_width = value.GetTensorTypeAndShapeInfo().GetShape().back();
+        } else if (name == kTopTokenIds && !preallocated_top_k) {
+            context.step_tokens = value.GetTensorData<int64_t>();
+        } else if (index >= 0 && first_step) {
+            // present.* первого шага выделены ONNX Runtime: копируются в буферы кеша один раз.
+            CacheTensor &cache = context.past[index];
+            cache.shape = value.GetTensorTypeAndShapeInfo().GetShape();
+            const float *data = value.GetTensorData<float>();
+            cache.buffers[0].assign(data, data + element_count(cache.shape));
+            cache.current = 0;
+        } else if (name == "logits" && !preallocated_logits) {
+            const float *logits_data = value.GetTensorData<float>();
+            size_t vocab = value.GetTensorTypeAndShapeInfo().GetShape().back();
+            context.step_width = vocab;
+            context.step_scores = logits_data;
+            if (sequence_length == 1)
+                continue;
+            context.logits.resize(batch_size * vocab);
+            for (size_t b = 0; b < batch_size; ++b) {
+                const float *last = logits_data + ((b + 1) * sequence_length - 1) * vocab;
+                std::copy(last, last + vocab, context.logits.begin() + b * vocab);
+            }
+            context.step_scores = context.logits.data();
+        }
+    }
+}
 
-    float *logits_data = output_tensors.front().GetTensorMutableData<float>();
-    size_t vocab_size = output_tensors.front().GetTensorTypeAndShapeInfo().GetShape().back();
+void Translator::reorder_past(std::vector<CacheTensor> &past, const size_t *rows,
+                              size_t count) const {
+    for (CacheTensor &cache : past) {
+        std::vector<int64_t> &shape = cache.shape;
+        size_t row_size = element_count(shape) / shape[0];
+
+        // Порядок лучей не изменился (например, при жадном поиске) — кеш остаётся как есть.
+        bool identity = static_cast<size_t>(shape[0]) == count;
+        for (size_t i = 0; identity && i < count; ++i)
+            identity = rows[i] == i;
+        if (identity)
+            continue;
+
+        // Строки собираются в освободившийся буфер: present.* уже перенесены в текущий.
+        const std::vector<float> &source = cache.buffers[cache.current];
+        std::vector<float> &target = cache.buffers[1 - cache.current];
+        target.resize(count * row_size);
+        for (size_t i = 0; i < count; ++i)
+            std::copy(source.begin() + rows[i] * row_size, source.begin() + (rows[i] + 1) * row_size,
+                      target.begin() + i * row_size);
+        shape[0] = static_cast<int64_t>(count);
+        cache.current ^= 1;
+    }
+}
 
-    return std::vector<float>(logits_data + (input_ids.size() - 1) * vocab_size,
-                         logits_data + input_ids.size() * vocab_size);
+int Translator::past_index(const std::string &name) const {
+    std::string suffix;
+    if (starts_with(name, kPastPrefix))
+        suffix = name.substr(kPastPrefix.size());
+    else if (starts_with(name, kPresentPrefix))
+        suffix = name.substr(kPresentPrefix.size());
+    else
+        return -1;
+
+    for (size_t i = 0; i < past_names.size(); ++i)
+        if (past_names[i].compare(kPastPrefix.size(), std::string::npos, suffix) == 0)
+            return static_cast<int>(i);
+    return -1;
 }
 
-std::vector<float> Translator::softmax(const std::vector<float> &logits) {
+std::vector<float> Translator::softmax(const std::vector<float> &logits) const {
     float max_logit = *std::max_element(logits.begin(), logits.end());
     std::vector<float> exps(logits.size());
     for (size_t i = 0; i < logits.size(); ++i)
@@ -166,7 +701,8 @@ std::vector<float> Translator::softmax(const std::vector<float> &logits) {
     return exps;
 }
 
-std::vector<std::pair<int64_t, float>> Translator::top_k(const std::vector<float> &probs, int k) {
+std::vector<std::pair<int64_t, float>> Translator::top_k(const std::vector<float> &probs,
+                                                        int k) const {
     std::vector<std::pair<int64_t, float>> topk;
     for (int64_t i = 0; i < (int64_t)probs.size(); ++i)
         topk.emplace_back(i, probs[i]);
@@ -176,6 +712,6 @@ std::vector<std::pair<int64_t, float>> Translator::top_k(const std::vector<float
     return topk;
 }
 
-std::string Translator::decode_ids(const std::vector<int64_t> &ids) {
+std::string Translator::decode_ids(const std::vector<int64_t> &ids) const {
     return tokenizer.decode(ids);
 }
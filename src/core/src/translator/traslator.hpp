@@ -1,3 +1,5 @@
+#pragma once
+
 #define _SAL_VERSION 20
 #define _Out_
 #define _In_
@@ -12,27 +14,19 @@
 
 
 #include "../tokenizer/tokenizer.hpp"
+#include "beam_search.hpp"
+#include "length_policy.hpp"
+#include "onnx_initializers.hpp"
+#include "runtime_options.hpp"
 #include <onnxruntime_cxx_api.h>
+#include <atomic>
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
-/**
- * @brief Структура для представления луча в алгоритме поиска по лучу (beam search).
- */
-struct Beam {
-    std::vector<int64_t> tokens; ///< Последовательность токенов в луче.
-    float score;                 ///< Оценка луча (логарифм вероятности).
-
-    /**
-     * @brief Оператор сравнения для использования в priority_queue.
-     * @param other Другой луч для сравнения.
-     * @return true, если текущий луч имеет меньший score.
-     */
-    bool operator<(const Beam &other) const { return score < other.score; }
-};
-
 /**
  * @brief Класс для перевода текста с использованием моделей ONNX и токенизатора.
  *
@@ -43,33 +37,113 @@ class Translator {
 public:
     /**
      * @brief Конструктор, инициализирующий переводчик с токенизатором и моделями.
-     * @param tokenizer Токенизатор для обработки текста.
+     * @param tokenizer Токенизатор для обработки текста (словарь разделяется, а не копируется).
      * @param encoder_path Путь к ONNX-модели энкодера.
      * @param decoder_path Путь к ONNX-модели декодера.
      * @param pad_token_id Идентификатор токена заполнения (<pad>).
      * @param eos_token_id Идентификатор токена конца последовательности (<eos>).
-     * @param max_length Максимальная длина генерируемой последовательности.
-     * @param beam_width Количество лучей в алгоритме beam search.
+     * @param max_length Максимальная длина генерируемой последовательности
+     *        (фиксированная; см. set_length_policy).
+     * @param beam_width Количество лучей в алгоритме beam search; 1 — жадное
+     *        декодирование, 2–5 — специализированные варианты с состоянием
+     *        фиксированного размера.
+     * @param decoder_with_past_path Путь к ONNX-модели декодера с кешем (decoder_with_past);
+     *        пустая строка — без отдельной модели.
+     * @param runtime_options Потоки и память ONNX Runtime; по умолчанию — один поток
+     *        на сессию. Сессии создаются в общем окружении процесса (shared_environment);
+     *        runtime_options.session_replicas задаёт число реплик сессий, веса
+     *        которых предупаковываются один раз и разделяются.
      * @throws Ort::Exception Если не удалось загрузить модели ONNX.
+     * @throws std::runtime_error Если декодер не возвращает кеш, нужный decoder_with_past,
+     *         голова TopK декодера имеет неизвестное или меньшее 2 * beam_width
+     *         число продолжений, или общие пулы потоков запрошены после создания
+     *         окружения без них.
+     *
+     * Если задан decoder_with_past_path или decoder_path указывает на объединённый
+     * декодер (decoder_model_merged), каждый шаг обрабатывает только новый токен,
+     * а ключи и значения внимания переносятся между шагами. Иначе на каждом шаге
+     * декодер получает весь префикс.
      *
      * Пример:
      *   Tokenizer tokenizer("vocab.json");
-     *   Translator translator(tokenizer, "encoder.onnx", "decoder.onnx", 0, 2, 50, 3);
+     *   Translator translator(tokenizer, "encoder.onnx", "decoder.onnx", 0, 2, 50, 3,
+     *                         "decoder_with_past.onnx");
      */
-    Translator(const Tokenizer tokenizer, const std::string &encoder_path,
+    Translator(const Tokenizer &tokenizer, const std::string &encoder_path,
                const std::string &decoder_path, int pad_token_id, int eos_token_id,
-               int max_length = 50, int beam_width = 3);
+               int max_length = 50, int beam_width = 3,
+               const std::string &decoder_with_past_path = "",
+               const RuntimeOptions &runtime_options = {});
 
     /**
      * @brief Переводит входной текст.
      * @param input Входной текст для перевода.
      * @return Переведённый текст.
      *
+     * Метод константен и реентерабелен: несколько потоков могут одновременно
+     * переводить одним экземпляром, разделяя его сессии ONNX Runtime. Настройки
+     * (set_length_policy, set_beam_options) задаются до начала таких вызовов.
+     *
      * Пример:
      *   std::string input = "Hello World";
      *   translator.run(input) // возвращает, например, "Hola Mundo"
      */
-    std::string run(const std::string &input);
+    std::string run(const std::string &input) const;
+
+    /**
+     * @brief Переводит несколько текстов одним пакетом.
+     * @param inputs Входные тексты.
+     * @return Переводы в порядке входов.
+     *
+     * Токены всех текстов дополняются pad_token_id до общей длины и кодируются
+     * одним запуском энкодера [N, max_len] с маской внимания. Затем гипотезы всех
+     * текстов декодируются вместе; текст выбывает из пакета, как только его поиск
+     * завершён. Для больших объёмов (документы, субтитры) это заметно
+     * быстрее, чем N вызовов run. Метод константен и реентерабелен, как run.
+     *
+     * Пример:
+     *   std::vector<std::string> lines = {"Hello", "How are you?"};
+     *   std::vector<std::string> translated = translator.translate_batch(lines);
+     */
+    std::vector<std::string> translate_batch(const std::vector<std::string> &inputs) const;
+
+    /**
+     * @brief Задаёт правило выбора максимальной длины перевода по длине входа.
+     * @param policy Правило; заменяет фиксированный max_length конструктора.
+     *
+     * Пример:
+     *   translator.set_length_policy(LengthPolicy::for_language_pair("en", "ru"));
+     */
+    void set_length_policy(const LengthPolicy &policy);
+
+    /**
+     * @brief Задаёт штраф за длину и правила досрочного завершения beam search.
+     * @param options Параметры завершения поиска.
+     *
+     * Пример:
+     *   translator.set_beam_options({0.6f, true}); // мягкий штраф, оптимистичная остановка
+     */
+    void set_beam_options(const BeamSearchOptions &options);
+
+    /**
+     * @brief Счётчики использования пула реплик сессий.
+     */
+    struct SessionPoolStats {
+        size_t replicas = 0;                 ///< Количество реплик.
+        size_t active = 0;                   ///< Переводов, выполняющихся сейчас.
+        size_t peak_active = 0;              ///< Наибольшее число одновременных переводов.
+        uint64_t checkouts = 0;              ///< Всего выдач реплик.
+        std::vector<size_t> replica_active;  ///< Текущая загрузка каждой реплики.
+    };
+
+    /**
+     * @brief Возвращает счётчики использования пула реплик.
+     *
+     * Пример:
+     *   Translator::SessionPoolStats stats = translator.session_pool_stats();
+     *   double utilization = double(stats.active) / stats.replicas;
+     */
+    SessionPoolStats session_pool_stats() const;
 
        /**
      * @brief Декодирует идентификаторы токенов в текст.
@@ -80,10 +154,13 @@ public:
      *   std::vector<int64_t> ids = {101, 102};
      *   decode_ids(ids) // возвращает, например, "Hello World"
      */
-    std::string decode_ids(const std::vector<int64_t> &ids);
+    std::string decode_ids(const std::vector<int64_t> &ids) const;
 
     /**
      * @brief Применяет softmax к логитам для получения вероятностей.
+     *
+     * Эталонная реализация: в beam search используется select_top_candidates,
+     * не материализующая вероятности.
      * @param logits Вектор логитов.
      * @return Вектор вероятностей.
      *
@@ -91,7 +168,7 @@ public:
      *   std::vector<float> logits = {0.1, 0.2, 0.7};
      *   auto probs = softmax(logits); // возвращает нормализованные вероятности
      */
-    std::vector<float> softmax(const std::vector<float> &logits);
+    std::vector<float> softmax(const std::vector<float> &logits) const;
 
     /**
      * @brief Выбирает k токенов с наибольшими вероятностями.
@@ -99,47 +176,283 @@ public:
      * @param k Количество выбираемых токенов.
      * @return Вектор пар {токен, вероятность}, отсортированный по убыванию.
      */
-    std::vector<std::pair<int64_t, float>> top_k(const std::vector<float> &probs, int k);
+    std::vector<std::pair<int64_t, float>> top_k(const std::vector<float> &probs, int k) const;
 
 private:
-    Ort::Env env;                               ///< Окружение ONNX Runtime.
-    Ort::Session encoder_session;               ///< Сессия для энкодера ONNX.
-    Ort::Session decoder_session;               ///< Сессия для декодера ONNX.
-    Ort::SessionOptions session_options;        ///< Опции сессии ONNX.
-    Ort::AllocatorWithDefaultOptions allocator; ///< Аллокатор ONNX.
+    Ort::Env &env;                              ///< Общее окружение ONNX Runtime процесса.
+    /**
+     * @brief Реплика сессий модели: энкодер и декодеры.
+     *
+     * Session::Run не константен в C++ API, но потокобезопасен, поэтому
+     * реплику могут одновременно использовать несколько вызовов run.
+     */
+    struct SessionReplica {
+        Ort::Session encoder{nullptr};           ///< Сессия для энкодера ONNX.
+        Ort::Session decoder{nullptr};           ///< Сессия для декодера ONNX.
+        Ort::Session decoder_with_past{nullptr}; ///< Сессия декодера с кешем (может отсутствовать).
+        std::atomic<size_t> active{0};           ///< Переводов, выполняющихся на реплике.
+        std::atomic<uint64_t> checkouts{0};      ///< Всего выдач реплики.
+    };
+
+    /**
+     * @brief Выдача реплики одному вызову run; возвращает её в пул при разрушении.
+     */
+    class ReplicaLease {
+    public:
+        explicit ReplicaLease(const Translator &translator);
+        ~ReplicaLease();
+        ReplicaLease(const ReplicaLease &) = delete;
+        ReplicaLease &operator=(const ReplicaLease &) = delete;
+
+        SessionReplica &replica; ///< Выданная реплика.
+
+    private:
+        const Translator &translator; ///< Пул, в который возвращается реплика.
+    };
+
+    /**
+     * @brief Веса одного файла модели, общие для всех реплик.
+     *
+     * Сессии получают веса через AddInitializer и ссылаются на эти буферы
+     * вместо собственных копий; только такие веса ONNX Runtime предупаковывает
+     * один раз в prepacked_weights.
+     */
+    struct SharedWeights {
+        std::vector<OnnxInitializer> initializers; ///< Буферы весов.
+        std::vector<Ort::Value> values;            ///< Тензоры над буферами.
+        Ort::SessionOptions options{nullptr};      ///< session_options с добавленными весами.
+    };
+
+    Ort::PrepackedWeightsContainer prepacked_weights; ///< Предупакованные веса, общие для всех реплик.
+    std::map<std::string, std::unique_ptr<SharedWeights>> shared_weights; ///< Веса по пути к модели; переживают сессии replicas.
+    bool share_weights = false;                     ///< Реплик несколько: веса загружаются один раз и разделяются.
+    std::vector<std::unique_ptr<SessionReplica>> replicas; ///< Пул реплик сессий (не пуст).
+    mutable std::atomic<size_t> active_total{0};    ///< Переводов, выполняющихся сейчас на всех репликах.
+    mutable std::atomic<size_t> peak_active{0};     ///< Наибольшее число одновременных переводов.
+    Ort::SessionOptions session_options;            ///< Опции сессии ONNX.
+    mutable Ort::AllocatorWithDefaultOptions allocator; ///< Аллокатор ONNX (потокобезопасный).
+    Ort::MemoryInfo memory_info =
+        Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU); ///< Описание памяти CPU для тензоров над буферами.
 
     int pad_token_id; ///< Идентификатор токена заполнения.
     int eos_token_id; ///< Идентификатор токена конца последовательности.
-    int max_length;   ///< Максимальная длина генерируемой последовательности.
+    LengthPolicy length_policy; ///< Правило выбора максимальной длины перевода.
     int beam_width;   ///< Количество лучей в beam search.
+    BeamSearchOptions beam_options; ///< Штраф за длину и правила завершения beam search.
     Tokenizer tokenizer; ///< Токенизатор для обработки текста.
 
     /**
-     * @brief Кодирует входной текст в скрытое состояние энкодера.
-     * @param input_ids Вектор идентификаторов токенов.
-     * @return Скрытое состояние энкодера.
+     * @brief Имена входов и выходов модели декодера.
+     */
+    struct DecoderIo {
+        std::vector<std::string> inputs;  ///< Имена входов.
+        std::vector<std::string> outputs; ///< Имена выходов.
+        std::vector<std::string> fetched; ///< Выходы, которые запрашиваются на каждом шаге.
+        std::vector<int> input_past;      ///< Для каждого входа — индекс в past_names или -1.
+        std::vector<int> fetched_past;    ///< Для каждого выхода из fetched — индекс в past_names или -1.
+        bool top_k_head = false;          ///< Модель возвращает top_log_probs/top_token_ids вместо logits.
+        int64_t top_k = 0;                ///< Число продолжений головы TopK из формы top_token_ids.
+    };
+
+    DecoderIo decoder_io;                 ///< Входы и выходы декодера.
+    DecoderIo decoder_with_past_io;       ///< Входы и выходы декодера с кешем.
+    std::vector<std::string> past_names;  ///< Входы past_key_values.* (пусто — кеш не используется).
+    bool merged_decoder = false;          ///< Декодер — объединённый, с входом use_cache_branch.
+    std::vector<std::vector<int64_t>> empty_past_shapes; ///< Формы входов кеша объединённого декодера (-1 — динамические оси).
+    std::vector<bool> past_grows;         ///< Для каждого входа кеша: растёт ли он на токен за шаг (самовнимание) или постоянен (перекрёстное).
+    int64_t vocab_size = -1;              ///< Размер словаря из формы логитов модели (-1 — динамический).
+
+    /**
+     * @brief Двойной буфер одного тензора кеша ключей/значений.
+     *
+     * Кеш шага лежит в buffers[current]; декодер пишет present.* в другой
+     * буфер, а перестановка лучей собирает строки обратно в освободившийся.
+     * Буферы растут с запасом, как std::vector, поэтому выделения памяти редки.
+     * Форма — [batch, heads, length, head_dim]: кеш самовнимания растёт по
+     * предпоследней оси на один токен за шаг.
+     */
+    struct CacheTensor {
+        std::vector<float> buffers[2];    ///< Буферы кеша.
+        size_t current = 0;               ///< Буфер с кешем текущего шага.
+        std::vector<int64_t> shape;       ///< Форма кеша в buffers[current].
+        const float *view_data = nullptr; ///< Данные, над которыми создан тензор входа past_views.
+        std::vector<int64_t> view_shape;  ///< Форма этого тензора.
+    };
+
+    /**
+     * @brief Контекст одного вызова run: буферы, переиспользуемые на всех шагах декодера.
+     *
+     * Всё изменяемое состояние перевода живёт здесь, а не в Translator, поэтому
+     * параллельные вызовы run не разделяют ничего, кроме сессий ONNX Runtime.
+     * Создаётся один раз на входную фразу (begin_decode). Тензоры входов
+     * энкодера/декодера и логитов — представления над этими буферами для
+     * каждого размера пакета, поэтому шаг декодера только перепривязывает
+     * их в IoBinding, не копируя данные и не выделяя буферы.
+     *
+     * Исключение — кеш самовнимания: его длина растёт на каждом шаге, поэтому
+     * для каждого его входа past_key_values.* и выхода present.* на шаге
+     * создаётся новый заголовок Ort::Value над буфером кеша (данные не
+     * копируются). Тензоры кеша перекрёстного внимания пересоздаются, только
+     * когда перестановка лучей переносит кеш в другой буфер.
+     */
+    struct RequestContext {
+        Ort::Value encoder_output{nullptr};      ///< Выход энкодера [N, source_length, hidden] (если строки переставляются).
+        std::vector<int64_t> source_mask;        ///< Маска дополненных входов: [N, source_length].
+        size_t source_length = 0;                ///< Общая длина дополненных входов.
+        size_t hidden_size = 0;                  ///< Размер скрытого состояния энкодера.
+        Ort::Value encoder_hidden{nullptr};      ///< Выход энкодера по строкам пакета: [N * beam_width, source_length, hidden].
+        std::vector<int64_t> encoder_mask;       ///< Маска внимания энкодера по строкам пакета.
+        std::vector<size_t> row_sentences;       ///< Номер фразы каждой строки encoder_hidden/encoder_mask.
+        std::vector<int64_t> decoder_ids;        ///< Токены шага: [batch, t], ёмкость на весь перевод.
+        std::vector<Ort::Value> hidden_views;    ///< hidden_views[b - 1] — первые b строк encoder_hidden.
+        std::vector<Ort::Value> mask_views;      ///< mask_views[b - 1] — первые b строк encoder_mask.
+        std::vector<Ort::Value> ids_views;       ///< ids_views[b - 1] — decoder_ids формы [b, 1] (только с кешем).
+        bool use_cache_branch = false;           ///< Значение входа use_cache_branch.
+        Ort::Value cache_flag{nullptr};          ///< Тензор над use_cache_branch.
+        Ort::Value logits_buffer{nullptr};       ///< Логиты [beam_width, 1, vocab] (с кешем и известным vocab).
+        std::vector<Ort::Value> logits_views;    ///< logits_views[b - 1] — первые b строк logits_buffer.
+        std::vector<float> top_log_probs;        ///< Выход top_log_probs головы TopK: [N * beam_width, k] (только с кешем).
+        std::vector<int64_t> top_token_ids;      ///< Выход top_token_ids головы TopK: [N * beam_width, k] (только с кешем).
+        std::vector<Ort::Value> top_log_probs_views; ///< top_log_probs_views[b - 1] — первые b строк top_log_probs.
+        std::vector<Ort::Value> top_token_ids_views; ///< top_token_ids_views[b - 1] — первые b строк top_token_ids.
+        std::vector<Ort::Value> outputs;         ///< Выходы последнего шага.
+        std::vector<float> logits;               ///< Логиты последней позиции, если декодер получает весь префикс.
+        std::vector<CacheTensor> past;           ///< Кеш ключей/значений пакета (пуст до первого шага).
+        std::vector<Ort::Value> past_views;      ///< Тензоры над кешем шага, привязанные к входам past_key_values.*.
+        std::vector<Ort::Value> present_views;   ///< Тензоры над вторыми буферами кеша, привязанные к выходам present.*.
+        std::vector<Ort::Value> empty_past;      ///< Кеш нулевой длины [N, ...] для первого шага объединённого декодера.
+        SessionReplica *replica = nullptr;       ///< Реплика сессий, выданная вызову.
+        Ort::IoBinding decoder_binding{nullptr};           ///< Привязки декодера реплики.
+        Ort::IoBinding decoder_with_past_binding{nullptr}; ///< Привязки декодера с кешем реплики.
+        const float *step_scores = nullptr;      ///< Логиты [batch, step_width] или log-вероятности лучших токенов.
+        const int64_t *step_tokens = nullptr;    ///< Лучшие токены [batch, step_width] (голова TopK) или nullptr.
+        size_t step_width = 0;                   ///< Размер словаря или k головы TopK.
+    };
+
+    /**
+     * @brief Кодирует пакет входов в скрытое состояние энкодера.
+     * @param encoder Сессия энкодера реплики.
+     * @param input_ids Дополненные идентификаторы токенов: [batch_size, t].
+     * @param attention_mask Маска внимания: [batch_size, t].
+     * @param batch_size Количество входов.
+     * @return Выход энкодера last_hidden_state: [batch_size, t, hidden]; тензор
+     *         принадлежит вызывающему, данные не копируются.
      *
      * Пример:
-     *   std::vector<int64_t> input_ids = {101, 102};
-     *   auto hidden = encode_input(input_ids); // возвращает вектор скрытых состояний
+     *   std::vector<int64_t> input_ids = {101, 102}, mask = {1, 1};
+     *   Ort::Value hidden = encode_input(replica.encoder, input_ids, mask, 1);
+     */
+    Ort::Value encode_input(Ort::Session &encoder, std::vector<int64_t> &input_ids,
+                            std::vector<int64_t> &attention_mask, size_t batch_size) const;
+
+    /**
+     * @brief Кодирует входы и готовит буферы декодера для одного вызова.
+     * @param context Заполняемый контекст с выданной репликой; не должен
+     *        перемещаться после вызова.
+     * @param input_ids Токены входных текстов.
+     * @param max_length Максимальное число шагов декодера.
+     *
+     * Выход энкодера повторяется для beam_width лучей каждой фразы один раз;
+     * для одной фразы при beam_width == 1 используется без копирования.
+     */
+    void begin_decode(RequestContext &context, const std::vector<std::vector<int64_t>> &input_ids,
+                      int max_length) const;
+
+    /**
+     * @brief Раскладывает выход и маску энкодера по строкам пакета декодера.
+     * @param context Контекст вызова.
+     * @param layout Номер фразы для каждой строки пакета.
+     *
+     * Копирует строки, только если раскладка не совпадает с уже лежащей в
+     * начале буферов.
      */
-    std::vector<float> encode_input(const std::vector<int64_t> &input_ids);
+    void arrange_rows(RequestContext &context, const std::vector<size_t> &layout) const;
 
     /**
-     * @brief Выполняет один шаг декодирования.
-     * @param input_ids Текущая последовательность токенов декодера.
-     * @param encoder_input_ids Входные токены энкодера (маска внимания).
-     * @param encoder_hidden_state Скрытое состояние энкодера.
-     * @return Логиты для следующего токена.
+     * @brief Выполняет один шаг декодирования сразу для всех лучей.
+     * @param context Буферы перевода; context.decoder_ids содержит токены лучей,
+     *        уложенные подряд: [batch_size, sequence_length]. С кешем (непустой
+     *        context.past) — только последний токен каждого луча.
+     * @param batch_size Количество лучей в пакете.
+     * @param sequence_length Количество токенов каждого луча в context.decoder_ids.
+     *
+     * Результат шага — context.step_scores, context.step_tokens и context.step_width;
+     * указатели действительны до следующего шага. Если декодер экспортирован с
+     * головой TopK, это k лучших log-вероятностей и токенов каждого луча, иначе —
+     * логиты последней позиции [batch_size, vocab] (step_tokens == nullptr).
+     *
+     * С кешем логиты (или выходы головы TopK) пишутся прямо в буферы контекста,
+     * а present.* — во вторые буферы context.past, после чего буферы меняются
+     * ролями; GetOutputValues не вызывается. Исключение — первый шаг: его
+     * present.* выделяет ONNX Runtime, и они копируются в буферы кеша. Без кеша
+     * логиты последней позиции собираются в context.logits.
      *
      * Пример:
-     *   std::vector<int64_t> input_ids = {0};
-     *   std::vector<int64_t> enc_ids = {101, 102};
-     *   std::vector<float> enc_hidden = {...};
-     *   auto logits = decode_step(input_ids, enc_ids, enc_hidden); // возвращает логиты
-     */
-    std::vector<float> decode_step(const std::vector<int64_t> &input_ids,
-                                  const std::vector<int64_t> &encoder_input_ids,
-                                  const std::vector<float> &encoder_hidden_state);
+     *   decode_step(context, 2, 1);
+     */
+    void decode_step(RequestContext &context, size_t batch_size, size_t sequence_length) const;
+
+    /**
+     * @brief Переставляет строки кеша в порядке лучей следующего шага.
+     * @param past Кеш ключей/значений пакета.
+     * @param rows Для каждого нового луча — индекс луча-родителя.
+     * @param count Количество новых лучей.
+     *
+     * Строки собираются во второй буфер каждого тензора, который затем
+     * становится текущим; если порядок лучей не изменился, копирования нет.
+     */
+    void reorder_past(std::vector<CacheTensor> &past, const size_t *rows, size_t count) const;
+
+    /**
+     * @brief Генерирует переводы пакета заданной стратегией поиска.
+     * @tparam Search GreedySearch, FixedBeamSearch<N> или BeamSearch.
+     * @param input_ids Токены входных текстов.
+     * @return Переведённые тексты.
+     */
+    template <class Search>
+    std::vector<std::string> generate(const std::vector<std::vector<int64_t>> &input_ids) const;
+
+    /**
+     * @brief Возвращает опции сессии для файла модели.
+     * @param path Путь к модели.
+     * @return session_options или, если реплик несколько, их копия, в которую
+     *         добавлены веса модели, прочитанные при первом обращении.
+     * @throws std::runtime_error Если веса модели не удалось прочитать.
+     */
+    const Ort::SessionOptions &model_options(const std::string &path);
+
+    /**
+     * @brief Загружает реплику сессий модели с общими весами и их предупакованными копиями.
+     * @param encoder_path Путь к энкодеру.
+     * @param decoder_path Путь к декодеру.
+     * @param decoder_with_past_path Путь к декодеру с кешем; пустая строка — без него.
+     */
+    std::unique_ptr<SessionReplica> create_replica(const std::string &encoder_path,
+                                                   const std::string &decoder_path,
+                                                   const std::string &decoder_with_past_path);
+
+    /**
+     * @brief Выдаёт наименее загруженную реплику и учитывает её как занятую.
+     *
+     * Выбор и захват реплики — одно сравнение с обменом её счётчика active:
+     * если другой поток успел занять выбранную реплику, выбор повторяется.
+     * Выдача не блокирует: реплики потокобезопасны, пул лишь распределяет
+     * вызовы между ними.
+     */
+    SessionReplica &checkout() const;
+
+    /**
+     * @brief Возвращает реплику, выданную checkout, в пул.
+     */
+    void release(SessionReplica &replica) const;
+
+    /**
+     * @brief Возвращает индекс входа past_key_values.*, соответствующего имени входа или выхода.
+     * @return Индекс в past_names или -1.
+     *
+     * Вызывается только в конструкторе: на шагах декодера индексы берутся из
+     * DecoderIo::input_past и DecoderIo::fetched_past.
+     */
+    int past_index(const std::string &name) const;
 
 };
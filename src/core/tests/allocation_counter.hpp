@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Возвращает число вызовов глобального operator new с начала работы тестов.
+ *
+ * Глобальные operator new/delete подменяются в allocation_counter.cpp, поэтому
+ * разность двух значений показывает, сколько выделений памяти сделал участок кода.
+ */
+size_t allocation_count();
@@ -0,0 +1,24 @@
+#include <doctest/doctest.h>
+#include "../src/tokenizer/tokenizer.hpp"
+#include <ostream>
+
+// Собирается с исходником, сгенерированным vocab_compiler --emit-cpp из
+// EMBEDDED_VOCAB_JSON, и с TOKENIZER_EMBEDDED_VOCAB.
+
+TEST_CASE("Embedded vocabulary from vocab_compiler matches its vocab.json") {
+    Tokenizer embedded(Vocabulary::embedded());
+    Tokenizer json(EMBEDDED_VOCAB_JSON);
+
+    for (const std::string text : {"hello world", "hello world!", "привет world", "unknown"}) {
+        std::vector<int64_t> ids = embedded.encode(text);
+        CHECK(ids == json.encode(text));
+        CHECK(embedded.decode(ids) == json.decode(ids));
+    }
+    CHECK(embedded.decode(embedded.encode("hello world!")) == "hello world!");
+
+    CHECK(embedded.token_to_id("▁hello") == 1);
+    CHECK(embedded.token_to_id("вет") == 8);
+    CHECK(embedded.token_to_id("▁missing") == -1);
+    CHECK(embedded.id_to_token(4) == "▁wor");
+    CHECK(Vocabulary::embedded() == embedded.vocabulary());
+}
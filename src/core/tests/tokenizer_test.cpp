@@ -1,5 +1,10 @@
 #include <doctest/doctest.h>
 #include "../src/tokenizer/tokenizer.hpp"
+#include "../src/tokenizer/detokenizer.hpp"
+#include "../src/tokenizer/vocabulary_registry.hpp"
+#include "../src/tokenizer/pretokenizer.hpp"
+#include "allocation_counter.hpp"
+#include <thread>
 
 static const std::string vocab_json = R"({
     "▁hello": 1,
@@ -60,3 +65,274 @@ TEST_CASE("Tokenizer throws if vocab path invalid") {
     CHECK_THROWS_AS(Tokenizer("nonexistent.json"), std::runtime_error);
     CHECK_THROWS_WITH_AS(Tokenizer("nonexistent.json"), "Failed to open vocab file", std::runtime_error);
 }
+
+TEST_CASE("Tokenizer prefers the longest matching token") {
+    std::ofstream("vocab_longest.json") << R"({"<unk>": 0, "▁": 1, "▁he": 2, "▁hello": 3, "l": 4, "o": 5, "w": 6})";
+    Tokenizer t("vocab_longest.json");
+    auto ids = t.encode("hello hellow");
+    REQUIRE(ids.size() == 3);
+    CHECK(ids[0] == 3);
+    CHECK(ids[1] == 3);
+    CHECK(ids[2] == 6);
+}
+
+TEST_CASE("Tokenizer matches multibyte UTF-8 tokens") {
+    std::ofstream("vocab_utf8.json") << R"({"<unk>": 0, "▁при": 1, "вет": 2, "▁привет": 3, "ствую": 4})";
+    Tokenizer t("vocab_utf8.json");
+    auto ids = t.encode("приветствую привет");
+    REQUIRE(ids.size() == 3);
+    CHECK(ids[0] == 3);
+    CHECK(ids[1] == 4);
+    CHECK(ids[2] == 3);
+}
+
+TEST_CASE("Trie finds longest and exact matches") {
+    DoubleArrayTrie trie;
+    trie.build({{"a", 1}, {"ab", 2}, {"abcd", 3}, {"b", 4}});
+    size_t len = 0;
+    CHECK(trie.longest_match("abcx", 4, len) == 2);
+    CHECK(len == 2);
+    CHECK(trie.longest_match("abcd", 4, len) == 3);
+    CHECK(len == 4);
+    CHECK(trie.longest_match("x", 1, len) == -1);
+    CHECK(trie.exact_match("abc", 3) == -1);
+    CHECK(trie.exact_match("b", 1) == 4);
+}
+
+TEST_CASE("Tokenizer loads compiled binary vocab") {
+    compile_vocab(make_vocab_file(), "vocab_test.bin");
+    Tokenizer json_tok(make_vocab_file());
+    Tokenizer bin_tok("vocab_test.bin");
+    CHECK(bin_tok.encode("hello world foo") == json_tok.encode("hello world foo"));
+    CHECK(bin_tok.decode({3, 1, 2, 3}) == "hello world");
+}
+
+TEST_CASE("Tokenizer rejects corrupted binary vocab") {
+    std::ofstream("vocab_broken.bin", std::ios::binary) << std::string(kBinaryVocabMagic, 8) << "garbage";
+    CHECK_THROWS_AS(Tokenizer("vocab_broken.bin"), std::runtime_error);
+
+    // Убывающие смещения токенов при верном последнем смещении.
+    compile_vocab(make_vocab_file(), "vocab_broken.bin");
+    std::fstream file("vocab_broken.bin", std::ios::binary | std::ios::in | std::ios::out);
+    BinaryVocabHeader header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    uint32_t offset = header.pool_size;
+    file.seekp(header.offsets_offset + sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    file.close();
+    CHECK_THROWS_AS(Tokenizer("vocab_broken.bin"), std::runtime_error);
+
+    // Размеры секций, с которыми сумма смещения и размера переполняет uint64_t.
+    auto corrupt_header = [](void (*corrupt)(BinaryVocabHeader &)) {
+        compile_vocab(make_vocab_file(), "vocab_broken.bin");
+        std::fstream file("vocab_broken.bin", std::ios::binary | std::ios::in | std::ios::out);
+        BinaryVocabHeader header;
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        corrupt(header);
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    };
+    static_assert(sizeof(DoubleArrayTrie::Unit) % 4 == 0, "trie_size * 2^62 must wrap to zero");
+    corrupt_header([](BinaryVocabHeader &header) { header.trie_size += uint64_t(1) << 62; });
+    CHECK_THROWS_AS(Tokenizer("vocab_broken.bin"), std::runtime_error);
+    corrupt_header([](BinaryVocabHeader &header) { header.pool_offset = 0 - header.pool_size; });
+    CHECK_THROWS_AS(Tokenizer("vocab_broken.bin"), std::runtime_error);
+    corrupt_header([](BinaryVocabHeader &header) { header.flags_offset = ~uint64_t(0); });
+    CHECK_THROWS_AS(Tokenizer("vocab_broken.bin"), std::runtime_error);
+}
+
+TEST_CASE("Tokenizer looks up tokens by dense id") {
+    Tokenizer t(make_vocab_file());
+    CHECK(t.id_to_token(1) == "▁hello");
+    CHECK(t.id_to_token(3) == "<pad>");
+    CHECK(t.id_to_token(42).empty());
+    CHECK(t.decode({42, -1, 1}) == "hello");
+}
+
+TEST_CASE("Tokenizer copies share one vocabulary") {
+    auto vocab = Vocabulary::load(make_vocab_file());
+    Tokenizer a(vocab);
+    Tokenizer b = a;
+    CHECK(b.vocabulary() == vocab);
+    CHECK(b.token_to_id("▁world") == 2);
+    CHECK(b.token_to_id("▁nothing") == -1);
+    CHECK_THROWS_AS(Tokenizer(std::shared_ptr<const Vocabulary>()), std::invalid_argument);
+}
+
+TEST_CASE("Tokenizer encode_into and decode_into reuse caller buffers") {
+    Tokenizer t(make_vocab_file());
+    std::vector<int64_t> ids;
+    std::string text;
+
+    t.encode_into("  hello\t\nworld foo ", ids);
+    REQUIRE(ids == std::vector<int64_t>{1, 2, 0});
+    t.decode_into(ids.data(), ids.size(), text);
+    REQUIRE(text == "hello world<unk>");
+
+    size_t before = allocation_count();
+    for (int i = 0; i < 100; ++i) {
+        t.encode_into("hello world\tfoo  hello", ids);
+        t.decode_into(ids.data(), ids.size(), text);
+    }
+    CHECK(allocation_count() == before);
+    CHECK(ids.size() == 4);
+}
+
+TEST_CASE("WordSplitter splits on every whitespace run") {
+    std::string text;
+    std::vector<std::string> expected;
+    const char *spaces[] = {" ", "\t", "\n\r", "\v\f", "  \t\t\n                                                                        "};
+    for (int i = 0; i < 200; ++i) {
+        std::string word(1 + (i * 7) % 45, static_cast<char>('a' + i % 26));
+        if (i % 5 == 0)
+            word += "\xd0\xbf\xe2\x96\x81";
+        text += spaces[i % 5];
+        text += word;
+        expected.push_back(word);
+    }
+
+    for (size_t cut : {text.size(), text.size() - 1, size_t(64), size_t(65), size_t(127)}) {
+        std::string_view view(text.data(), cut);
+        std::vector<std::string> words;
+        WordSplitter splitter(view);
+        std::string_view word;
+        while (splitter.next(word))
+            words.emplace_back(word);
+
+        std::vector<std::string> reference;
+        size_t pos = 0;
+        while (pos < view.size()) {
+            while (pos < view.size() && isspace(static_cast<unsigned char>(view[pos])))
+                ++pos;
+            size_t end = pos;
+            while (end < view.size() && !isspace(static_cast<unsigned char>(view[end])))
+                ++end;
+            if (end > pos)
+                reference.emplace_back(view.substr(pos, end - pos));
+            pos = end;
+        }
+        CHECK(words == reference);
+    }
+}
+
+TEST_CASE("Tokenizer word cache returns the same tokens and counts hits") {
+    Tokenizer t(make_vocab_file());
+    t.enable_word_cache(8);
+    auto first = t.encode("hello world foo hello");
+    auto second = t.encode("hello world foo hello");
+    CHECK(first == second);
+    CHECK(first == std::vector<int64_t>{1, 2, 0, 1});
+
+    WordCache::Stats stats = t.word_cache()->stats();
+    CHECK(stats.misses == 3);
+    CHECK(stats.hits == 5);
+    CHECK(stats.size == 3);
+
+    std::vector<int64_t> ids;
+    t.encode_into("hello world foo", ids);
+    size_t before = allocation_count();
+    t.encode_into("hello world foo", ids);
+    CHECK(allocation_count() == before);
+}
+
+TEST_CASE("WordCache evicts when full and stays usable from many threads") {
+    WordCache cache(32);
+    std::vector<std::thread> threads;
+    for (int n = 0; n < 4; ++n) {
+        threads.emplace_back([&cache, n] {
+            std::vector<int64_t> out;
+            for (int i = 0; i < 2000; ++i) {
+                std::string word = "w" + std::to_string((i * 7 + n) % 100);
+                int64_t id = (i * 7 + n) % 100;
+                out.clear();
+                if (cache.lookup(word, out))
+                    CHECK(out == std::vector<int64_t>{id, id});
+                else
+                    cache.insert(word, std::vector<int64_t>{id, id}.data(), 2);
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    WordCache::Stats stats = cache.stats();
+    CHECK(stats.size <= 32);
+    CHECK(stats.hits + stats.misses == 8000);
+}
+
+TEST_CASE("IncrementalDetokenizer emits only new text and matches decode") {
+    std::ofstream("vocab_stream.json") << R"({"</s>": 0, "<unk>": 1, "<pad>": 2, "▁hel": 3, "lo": 4, "▁world": 5, "!": 6})";
+    Tokenizer t("vocab_stream.json");
+    IncrementalDetokenizer stream(t);
+
+    std::vector<int64_t> ids = {2, 3, 4, 5, 6, 42, 0};
+    std::vector<std::string> pieces;
+    for (int64_t id : ids)
+        pieces.emplace_back(stream.push(id));
+
+    CHECK(pieces == std::vector<std::string>{"", "hel", "lo", " world", "!", "", ""});
+    CHECK(stream.text() == t.decode(ids));
+
+    stream.reset();
+    CHECK(stream.push(5) == "world");
+}
+
+TEST_CASE("Vocabulary registry deduplicates identical vocab files") {
+    std::ofstream("vocab_copy_a.json") << vocab_json;
+    std::ofstream("vocab_copy_b.json") << vocab_json;
+    std::ofstream("vocab_other.json") << R"({"<unk>": 0, "▁other": 1})";
+
+    Tokenizer a("vocab_copy_a.json");
+    Tokenizer b("vocab_copy_b.json");
+    Tokenizer c("vocab_other.json");
+    CHECK(a.vocabulary() == b.vocabulary());
+    CHECK(a.vocabulary() != c.vocabulary());
+
+    std::weak_ptr<const Vocabulary> released;
+    {
+        std::ofstream("vocab_temp.json") << R"({"<unk>": 0, "▁temp": 1})";
+        Tokenizer temp("vocab_temp.json");
+        released = temp.vocabulary();
+    }
+    CHECK(released.expired());
+
+    // Одновременные загрузки одного содержимого разбирают его один раз.
+    std::ofstream("vocab_stream.json") << R"({"<unk>": 0, "▁stream": 1})";
+    std::vector<std::shared_ptr<const Vocabulary>> loaded(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < loaded.size(); ++i)
+        threads.emplace_back([&loaded, i] {
+            loaded[i] = Vocabulary::load(i % 2 ? "vocab_stream.json" : "vocab_copy_a.json");
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+    for (size_t i = 2; i < loaded.size(); ++i)
+        CHECK(loaded[i] == loaded[i % 2]);
+    CHECK(loaded[0] == a.vocabulary());
+    CHECK(loaded[1] != loaded[0]);
+}
+
+TEST_CASE("Embedded vocabulary tables match the JSON vocabulary") {
+    std::vector<std::pair<std::string, int64_t>> entries = read_json_vocab(make_vocab_file());
+    TokenTable table = build_token_table(entries);
+    PerfectHash hash = build_perfect_hash(entries);
+    DoubleArrayTrie trie;
+    trie.build(entries);
+
+    EmbeddedVocab data{table.offsets.data(), table.flags.data(),  table.pool.data(),
+                       table.offsets.size() - 1, trie.data(),     trie.size(),
+                       hash.seeds.data(),        hash.seeds.size(), hash.slots.data(),
+                       hash.slots.size()};
+    Tokenizer embedded(std::make_shared<const Vocabulary>(data));
+    Tokenizer json(make_vocab_file());
+
+    CHECK(embedded.encode("hello world") == json.encode("hello world"));
+    CHECK(embedded.token_to_id("▁world") == 2);
+    CHECK(embedded.token_to_id("<pad>") == 3);
+    CHECK(embedded.token_to_id("▁missing") == -1);
+    CHECK(embedded.decode({1, 2}) == "hello world");
+}
+
+TEST_CASE("Perfect hash rejects tokens with the same hash without searching seeds") {
+    CHECK_THROWS_AS(build_perfect_hash({{"▁a", 1}, {"▁b", 2}, {"▁a", 3}}), std::runtime_error);
+}
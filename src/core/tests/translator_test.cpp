@@ -1,9 +1,24 @@
 #include <doctest/doctest.h>
 #include "../src/translator/traslator.hpp"
+#include "../src/translator/beam_kernels.hpp"
+#include "../src/translator/beam_search.hpp"
+#include "../src/translator/model_registry.hpp"
+#include "../src/translator/onnx_initializers.hpp"
+#include "../src/translator/batch_scheduler.hpp"
+#include "allocation_counter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <random>
+#include <thread>
 
 const std::string json = R"({"▁a": 10, "<pad>": 0})";
 const std::string encoder_path = "../opus-mt-en-ru/encoder.onnx";
 const std::string decoder_path = "../opus-mt-en-ru/decoder.onnx";
+const std::string decoder_with_past_path = "../opus-mt-en-ru/decoder_with_past.onnx";
 
 std::string make_temp_vocab(const std::string& name = "temp_vocab.json") {
     std::ofstream(name) << json;
@@ -55,3 +70,500 @@ TEST_CASE("Translator throws on empty probability vector for top_k") {
     CHECK_THROWS_AS(tr.top_k(empty_probs, 1), std::invalid_argument);
     CHECK_THROWS_WITH(tr.top_k(empty_probs, 1), "probs is empty");
 }
+
+TEST_CASE("Translator with KV cache matches full-prefix decoding") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    Translator full(tok, encoder_path, decoder_path, 62517, 0, 20, 3);
+    Translator cached(tok, encoder_path, decoder_path, 62517, 0, 20, 3, decoder_with_past_path);
+    CHECK(cached.run("Hello world") == full.run("Hello world"));
+}
+
+TEST_CASE("Translator translate_batch matches per-sentence translation") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    const Translator translator(tok, encoder_path, decoder_path, 62517, 0, 20, 3,
+                                decoder_with_past_path);
+    // Разная длина входов: короткие фразы дополняются и завершаются раньше остальных.
+    const std::vector<std::string> inputs = {"Hello world", "Yes",
+                                             "The weather is nice today and we are going outside"};
+
+    std::vector<std::string> translated = translator.translate_batch(inputs);
+    REQUIRE(translated.size() == inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+        CHECK(translated[i] == translator.run(inputs[i]));
+    CHECK(translator.translate_batch({}).empty());
+}
+
+TEST_CASE("Translator runs concurrently on one shared instance") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    const Translator translator(tok, encoder_path, decoder_path, 62517, 0, 20, 3,
+                                decoder_with_past_path);
+    const std::vector<std::string> inputs = {"Hello world", "How are you?",
+                                             "The weather is nice today", "I like books"};
+    std::vector<std::string> expected;
+    for (const std::string &input : inputs)
+        expected.push_back(translator.run(input));
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < 12; ++i) {
+                size_t k = (t + i) % inputs.size();
+                if (translator.run(inputs[k]) != expected[k])
+                    ++mismatches;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    CHECK(mismatches == 0);
+}
+
+TEST_CASE("Translator spreads concurrent runs over session replicas") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    RuntimeOptions options;
+    options.session_replicas = 2;
+    const Translator translator(tok, encoder_path, decoder_path, 62517, 0, 20, 3,
+                                decoder_with_past_path, options);
+    const std::string expected = translator.run("Hello world");
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < 5; ++i)
+                if (translator.run("Hello world") != expected)
+                    ++mismatches;
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    CHECK(mismatches == 0);
+
+    Translator::SessionPoolStats stats = translator.session_pool_stats();
+    CHECK(stats.replicas == 2);
+    CHECK(stats.active == 0);
+    CHECK(stats.checkouts == 21);
+    CHECK(stats.peak_active >= 1);
+    CHECK(stats.peak_active <= 4);
+}
+
+TEST_CASE("BatchScheduler batches concurrent requests and matches run") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    auto translator = std::make_shared<const Translator>(tok, encoder_path, decoder_path, 62517, 0,
+                                                         20, 3, decoder_with_past_path);
+    const std::vector<std::string> inputs = {"Hello world", "How are you?",
+                                             "The weather is nice today", "I like books"};
+    std::vector<std::string> expected;
+    for (const std::string &input : inputs)
+        expected.push_back(translator->run(input));
+
+    BatchSchedulerOptions options;
+    options.max_batch_size = 4;
+    options.max_delay = std::chrono::milliseconds(5);
+    BatchScheduler scheduler(translator, options);
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < 3; ++i) {
+                size_t k = (t + i) % inputs.size();
+                if (scheduler.submit(inputs[k]).get() != expected[k])
+                    ++mismatches;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    CHECK(mismatches == 0);
+
+    BatchScheduler::Metrics metrics = scheduler.metrics();
+    CHECK(metrics.submitted == 24);
+    CHECK(metrics.completed == 24);
+    CHECK(metrics.failed == 0);
+    CHECK(metrics.queue_depth == 0);
+    CHECK(metrics.batches <= 24);
+    CHECK(metrics.dispatched == 24);
+    CHECK(metrics.batches ==
+          metrics.full_batches + metrics.deadline_batches + metrics.shutdown_batches);
+    CHECK(metrics.shutdown_batches == 0);
+    CHECK(metrics.average_batch_size() >= 1.0);
+    CHECK(metrics.batch_fill() <= 1.0);
+    CHECK(metrics.max_queue_wait >= metrics.average_queue_wait());
+}
+
+TEST_CASE("BatchScheduler flushes full batches and drains the queue on shutdown") {
+    Tokenizer tok("../opus-mt-en-ru/vocab.json");
+    auto translator = std::make_shared<const Translator>(tok, encoder_path, decoder_path, 62517, 0,
+                                                         20, 1, decoder_with_past_path);
+    BatchSchedulerOptions options;
+    options.max_batch_size = 3;
+    options.max_delay = std::chrono::seconds(30);
+    options.workers = 1;
+
+    std::vector<std::future<std::string>> results;
+    {
+        BatchScheduler scheduler(translator, options);
+        for (const char *input : {"Hello", "Good morning", "Thank you"})
+            results.push_back(scheduler.submit(input));
+        CHECK(results.front().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+
+        BatchScheduler::Metrics metrics = scheduler.metrics();
+        CHECK(metrics.batches == 1);
+        CHECK(metrics.full_batches == 1);
+        CHECK(metrics.average_batch_size() == 3.0);
+
+        // Оставшийся запрос не ждёт max_delay: деструктор переводит его сразу.
+        results.push_back(scheduler.submit("Goodbye"));
+    }
+    CHECK(results.back().get() == translator->run("Goodbye"));
+    CHECK(results.front().get() == translator->run("Hello"));
+
+    CHECK_THROWS_AS(BatchScheduler(nullptr), std::invalid_argument);
+    options.max_batch_size = 0;
+    CHECK_THROWS_AS(BatchScheduler(translator, options), std::invalid_argument);
+}
+
+TEST_CASE("Translators share one ONNX Runtime environment") {
+    Ort::Env &env = shared_environment({});
+    CHECK(&shared_environment({}) == &env);
+    // Пулы потоков задаются при создании окружения и позже не меняются.
+    CHECK_THROWS_AS(shared_environment(RuntimeOptions::global()), std::runtime_error);
+}
+
+TEST_CASE("ModelConfig uses decoder_with_past only if the export has it") {
+    std::remove("./decoder_with_past.onnx");
+    ModelConfig old_export = ModelConfig::from_directory("en", "ru", ".");
+    CHECK(old_export.decoder_path == "./decoder.onnx");
+    CHECK(old_export.decoder_with_past_path.empty());
+
+    std::ofstream("./decoder_with_past.onnx") << "onnx";
+    ModelConfig config = ModelConfig::from_directory("en", "ru", ".");
+    CHECK(config.decoder_with_past_path == "./decoder_with_past.onnx");
+    std::remove("./decoder_with_past.onnx");
+}
+
+TEST_CASE("ModelRegistry loads each model once and reports load state") {
+    ModelRegistry registry;
+    CHECK_THROWS_AS(registry.get("en", "ru"), std::out_of_range);
+
+    registry.add(ModelConfig::from_directory("xx", "yy", "missing-model"));
+    CHECK(registry.state("xx", "yy") == ModelState::NotLoaded);
+    CHECK(registry.preload() == 1);
+    CHECK(registry.state("xx", "yy") == ModelState::Failed);
+    CHECK_FALSE(registry.error("xx", "yy").empty());
+    CHECK_THROWS_AS(registry.get("xx", "yy"), std::runtime_error);
+
+    std::shared_ptr<const Translator> translator =
+        registry.get(ModelConfig::from_directory("en", "ru", "../opus-mt-en-ru"));
+    CHECK(registry.state("en", "ru") == ModelState::Ready);
+    CHECK(registry.get("en", "ru") == translator);
+    CHECK(registry.error("en", "ru").empty());
+}
+
+TEST_CASE("OnnxInitializers reads raw weights and skips the rest of the model") {
+    auto varint = [](std::string &out, uint64_t value) {
+        for (; value >= 0x80; value >>= 7)
+            out += static_cast<char>((value & 0x7f) | 0x80);
+        out += static_cast<char>(value);
+    };
+    auto number = [&](std::string &out, uint64_t field, uint64_t value) {
+        varint(out, field << 3);
+        varint(out, value);
+    };
+    auto bytes = [&](std::string &out, uint64_t field, const std::string &value) {
+        varint(out, field << 3 | 2);
+        varint(out, value.size());
+        out += value;
+    };
+
+    const float weights[] = {1.5f, -2.0f, 0.25f, 4.0f, 8.0f, -0.5f};
+    std::string weight;
+    number(weight, 1, 2);
+    number(weight, 1, 3);
+    number(weight, 2, 1); // FLOAT
+    bytes(weight, 8, "encoder.weight");
+    bytes(weight, 9, std::string(reinterpret_cast<const char *>(weights), sizeof(weights)));
+
+    // Размерности в упакованном виде, как их пишет protobuf 3.
+    const int64_t ids[] = {3, 9};
+    std::string packed_dims;
+    varint(packed_dims, 2);
+    std::string positions;
+    bytes(positions, 1, packed_dims);
+    number(positions, 2, 7); // INT64
+    bytes(positions, 8, "position_ids");
+    bytes(positions, 9, std::string(reinterpret_cast<const char *>(ids), sizeof(ids)));
+
+    // Веса в float_data загружает сама сессия.
+    std::string typed;
+    number(typed, 1, 1);
+    number(typed, 2, 1);
+    bytes(typed, 8, "bias");
+    bytes(typed, 4, std::string(4, '\0'));
+
+    std::string graph;
+    bytes(graph, 1, "node");
+    for (const std::string *tensor : {&weight, &positions, &typed})
+        bytes(graph, 5, *tensor);
+    std::string model;
+    number(model, 1, 8); // ir_version
+    bytes(model, 7, graph);
+
+    std::vector<OnnxInitializer> initializers = read_onnx_initializers(model.data(), model.size());
+    REQUIRE(initializers.size() == 2);
+    CHECK(initializers[0].name == "encoder.weight");
+    CHECK(initializers[0].data_type == 1);
+    CHECK(initializers[0].dims == std::vector<int64_t>{2, 3});
+    REQUIRE(initializers[0].size == sizeof(weights));
+    CHECK(std::equal(weights, weights + 6, reinterpret_cast<const float *>(initializers[0].data.get())));
+    CHECK(initializers[1].name == "position_ids");
+    CHECK(initializers[1].dims == std::vector<int64_t>{2});
+    CHECK(reinterpret_cast<const int64_t *>(initializers[1].data.get())[1] == 9);
+
+    std::string truncated = model.substr(0, model.size() - 3);
+    CHECK_THROWS_AS(read_onnx_initializers(truncated.data(), truncated.size()), std::runtime_error);
+    CHECK_THROWS_AS(read_onnx_initializers("missing.onnx"), std::runtime_error);
+}
+
+TEST_CASE("Fused beam top-k matches softmax and top_k across beams") {
+    const size_t vocab = 37;
+    std::vector<float> logits(2 * vocab);
+    for (size_t i = 0; i < logits.size(); ++i)
+        logits[i] = std::sin(i * 0.7f) * 5.0f;
+    std::vector<float> scores = {-0.5f, -2.0f};
+
+    // Эталон: явный softmax каждого луча и сортировка всех продолжений.
+    std::vector<std::pair<float, int64_t>> expected;
+    for (size_t b = 0; b < 2; ++b) {
+        const float *row = logits.data() + b * vocab;
+        float max_logit = *std::max_element(row, row + vocab);
+        double sum = 0.0;
+        for (size_t token = 0; token < vocab; ++token)
+            sum += std::exp(row[token] - max_logit);
+        for (size_t token = 0; token < vocab; ++token)
+            expected.emplace_back(scores[b] + std::log(std::exp(row[token] - max_logit) / sum),
+                                  b * vocab + token);
+    }
+    std::sort(expected.begin(), expected.end(), [](auto &a, auto &b) { return a.first > b.first; });
+
+    std::vector<BeamCandidate> candidates;
+    select_top_candidates(logits.data(), 2, vocab, scores.data(), 3, candidates);
+    REQUIRE(candidates.size() == 3);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        CHECK(candidates[i].beam * vocab + candidates[i].token == expected[i].second);
+        CHECK(candidates[i].score == doctest::Approx(expected[i].first).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Merged per-beam top-k matches selection over full logits") {
+    const size_t vocab = 41, k = 6;
+    std::vector<float> logits(3 * vocab);
+    for (size_t i = 0; i < logits.size(); ++i)
+        logits[i] = std::cos(i * 1.3f) * 6.0f;
+    std::vector<float> scores = {-0.1f, -1.5f, -0.7f};
+
+    // Так выглядят выходы головы LogSoftmax + TopK экспортированного декодера.
+    std::vector<float> log_probs;
+    std::vector<int64_t> token_ids;
+    for (size_t b = 0; b < 3; ++b) {
+        std::vector<BeamCandidate> row;
+        float zero = 0.0f;
+        select_top_candidates(logits.data() + b * vocab, 1, vocab, &zero, k, row);
+        for (const BeamCandidate &candidate : row) {
+            log_probs.push_back(candidate.score);
+            token_ids.push_back(candidate.token);
+        }
+    }
+
+    std::vector<BeamCandidate> expected, merged;
+    select_top_candidates(logits.data(), 3, vocab, scores.data(), k, expected);
+    merge_top_candidates(log_probs.data(), token_ids.data(), 3, k, scores.data(), k, merged);
+    std::array<BeamCandidate, 6> fixed;
+    REQUIRE(merge_top_candidates(log_probs.data(), token_ids.data(), 3, k, scores.data(), fixed) == k);
+
+    REQUIRE(merged.size() == k);
+    for (size_t i = 0; i < k; ++i) {
+        CHECK(merged[i].beam == expected[i].beam);
+        CHECK(merged[i].token == expected[i].token);
+        CHECK(merged[i].score == doctest::Approx(expected[i].score));
+        CHECK(fixed[i].token == expected[i].token);
+    }
+}
+
+TEST_CASE("BeamSearch backtracks hypotheses without allocating per step") {
+    BeamSearch search;
+    search.reset(0, 2, 4);
+    std::vector<BeamCandidate> first = {{-1.0f, 0, 5}, {-1.5f, 0, 6}};
+    std::vector<BeamCandidate> second = {{-1.2f, 1, 7}, {-1.4f, 0, 9}};
+    std::vector<int64_t> prefix(3);
+
+    size_t before = allocation_count();
+    search.advance(first, 9);
+    search.advance(second, 9);
+    search.prefix(0, prefix.data());
+    CHECK(allocation_count() == before);
+
+    CHECK(search.live_count() == 1);
+    CHECK(search.parents()[0] == 1);
+    CHECK(prefix == std::vector<int64_t>{0, 6, 7});
+
+    std::vector<int64_t> best;
+    REQUIRE(search.best(best));
+    CHECK(best == std::vector<int64_t>{0, 5, 9});
+}
+
+TEST_CASE("BeamSearch stops once enough hypotheses finished or none can win") {
+    BeamSearch search;
+    search.reset(0, 2, 10);
+    search.advance({{-0.1f, 0, 9}, {-0.2f, 0, 9}, {-3.0f, 0, 5}}, 9);
+    CHECK(search.done());
+
+    search.reset(0, 2, 10, {1.0f, true});
+    search.advance({{-0.1f, 0, 9}, {-3.0f, 0, 5}, {-4.0f, 0, 6}}, 9);
+    CHECK(search.live_count() == 2);
+    CHECK(search.done());
+
+    search.reset(0, 2, 10, {1.0f, false});
+    search.advance({{-0.1f, 0, 9}, {-3.0f, 0, 5}, {-4.0f, 0, 6}}, 9);
+    CHECK_FALSE(search.done());
+}
+
+TEST_CASE("BeamSearch prefers longer hypotheses under length penalty") {
+    BeamSearch search;
+    search.reset(0, 2, 10, {1.0f, false});
+    search.advance({{-1.0f, 0, 9}, {-1.1f, 0, 5}}, 9);
+    search.advance({{-1.5f, 0, 9}, {-4.0f, 0, 6}}, 9);
+
+    std::vector<int64_t> best;
+    REQUIRE(search.best(best));
+    CHECK(best == std::vector<int64_t>{0, 5, 9});
+}
+
+TEST_CASE("BeamSearch ranks live hypotheses with finished ones when the budget runs out") {
+    BeamSearch search;
+    search.reset(0, 2, 3, {1.0f, false});
+    search.advance({{-0.2f, 0, 5}, {-6.0f, 0, 9}, {-7.0f, 0, 6}}, 9);
+    search.advance({{-0.25f, 0, 7}, {-8.0f, 1, 8}}, 9);
+    search.advance({{-0.3f, 0, 4}, {-9.0f, 1, 3}}, 9);
+    CHECK_FALSE(search.done());
+
+    std::vector<int64_t> best;
+    REQUIRE(search.best(best));
+    CHECK(best == std::vector<int64_t>{0, 5, 7, 4});
+}
+
+TEST_CASE("FixedBeamSearch and GreedySearch match the runtime-width search") {
+    const size_t vocab = 37;
+    const int64_t eos = 3;
+    auto logits_for = [&](size_t step, size_t beams) {
+        std::vector<float> logits(beams * vocab);
+        for (size_t i = 0; i < logits.size(); ++i)
+            logits[i] = std::sin(static_cast<float>(i * 7 + step * 13)) * 4.0f;
+        return logits;
+    };
+
+    BeamSearch dynamic;
+    FixedBeamSearch<3> fixed;
+    dynamic.reset(0, 3, 12);
+    fixed.reset(0, 3, 12);
+    for (size_t step = 0; step < 12 && !dynamic.done(); ++step) {
+        REQUIRE(fixed.live_count() == dynamic.live_count());
+        std::vector<float> logits = logits_for(step, dynamic.live_count());
+        dynamic.step(logits.data(), vocab, eos);
+        fixed.step(logits.data(), vocab, eos);
+        for (size_t b = 0; b < dynamic.live_count(); ++b)
+            CHECK(fixed.parents()[b] == dynamic.parents()[b]);
+    }
+    CHECK(fixed.done() == dynamic.done());
+
+    std::vector<int64_t> expected, actual;
+    REQUIRE(dynamic.best(expected));
+    REQUIRE(fixed.best(actual));
+    CHECK(actual == expected);
+    CHECK_THROWS_AS(fixed.reset(0, 4, 12), std::invalid_argument);
+
+    GreedySearch greedy;
+    greedy.reset(0, 1, 12);
+    std::vector<int64_t> tokens = {0};
+    for (size_t step = 0; step < 12 && !greedy.done(); ++step) {
+        std::vector<float> logits = logits_for(step, 1);
+        tokens.push_back(std::max_element(logits.begin(), logits.end()) - logits.begin());
+        greedy.step(logits.data(), vocab, eos);
+    }
+    REQUIRE(greedy.best(actual));
+    CHECK(actual == tokens);
+}
+
+TEST_CASE("Tied logits are ranked by beam and token in every selection path") {
+    const size_t vocab = 23, width = 4, k = 2 * width;
+    const int64_t eos = 3;
+    std::mt19937 rng(17);
+    std::uniform_int_distribution<int> level(0, 3);
+
+    for (int run = 0; run < 300; ++run) {
+        BeamSearch dynamic;
+        FixedBeamSearch<4> fixed;
+        dynamic.reset(0, width, 10);
+        fixed.reset(0, width, 10);
+        for (size_t step = 0; step < 10 && !dynamic.done(); ++step) {
+            REQUIRE(fixed.live_count() == dynamic.live_count());
+            size_t beams = dynamic.live_count();
+            std::vector<float> logits(beams * vocab);
+            for (float &logit : logits)
+                logit = static_cast<float>(level(rng));
+
+            // Голова TopK отдаёт равные log-вероятности в произвольном порядке токенов.
+            std::vector<float> log_probs;
+            std::vector<int64_t> token_ids;
+            for (size_t b = 0; b < beams; ++b) {
+                std::vector<BeamCandidate> row;
+                float zero = 0.0f;
+                select_top_candidates(logits.data() + b * vocab, 1, vocab, &zero, k, row);
+                std::stable_sort(row.begin(), row.end(), [](auto &x, auto &y) {
+                    return x.score > y.score || (x.score == y.score && x.token > y.token);
+                });
+                for (const BeamCandidate &candidate : row) {
+                    log_probs.push_back(candidate.score);
+                    token_ids.push_back(candidate.token);
+                }
+            }
+            std::vector<BeamCandidate> selected, merged;
+            select_top_candidates(logits.data(), beams, vocab, dynamic.scores(), k, selected);
+            merge_top_candidates(log_probs.data(), token_ids.data(), beams, k, dynamic.scores(), k,
+                                 merged);
+            std::array<BeamCandidate, 8> unrolled;
+            REQUIRE(select_top_candidates(logits.data(), beams, vocab, dynamic.scores(), unrolled) ==
+                    selected.size());
+            REQUIRE(merged.size() == selected.size());
+            for (size_t i = 0; i < selected.size(); ++i) {
+                CHECK(unrolled[i].beam == selected[i].beam);
+                CHECK(unrolled[i].token == selected[i].token);
+                CHECK(merged[i].beam == selected[i].beam);
+                CHECK(merged[i].token == selected[i].token);
+            }
+
+            dynamic.step(logits.data(), vocab, eos);
+            fixed.step(logits.data(), vocab, eos);
+            for (size_t b = 0; b < dynamic.live_count(); ++b) {
+                CHECK(fixed.parents()[b] == dynamic.parents()[b]);
+                CHECK(fixed.last_tokens()[b] == dynamic.last_tokens()[b]);
+            }
+        }
+
+        std::vector<int64_t> expected, actual;
+        REQUIRE(dynamic.best(expected));
+        REQUIRE(fixed.best(actual));
+        CHECK(actual == expected);
+    }
+}
+
+TEST_CASE("LengthPolicy scales the decode budget with the input and caps it") {
+    LengthPolicy policy = LengthPolicy::for_language_pair("en", "ru");
+    CHECK(policy.budget(2) == 13);
+    CHECK(policy.budget(100) == 160);
+    CHECK(policy.budget(1000) == 512);
+    CHECK(LengthPolicy::fixed(50).budget(3) == 50);
+    CHECK(LengthPolicy::fixed(50).budget(300) == 50);
+}
@@ -0,0 +1,35 @@
+#include "../src/tokenizer/vocab_file.hpp"
+#include <exception>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Компилирует vocab.json в бинарный словарь или в исходник C++ для Tokenizer.
+ *
+ * Использование:
+ *   vocab_compiler opus-mt-en-ru/vocab.json opus-mt-en-ru/vocab.bin
+ *   vocab_compiler --emit-cpp opus-mt-en-ru/vocab.json embedded_vocab.cpp
+ */
+int main(int argc, char *argv[]) {
+    bool emit_cpp = argc == 4 && std::string(argv[1]) == "--emit-cpp";
+    if (argc != 3 && !emit_cpp) {
+        std::cerr << "Usage: " << argv[0] << " [--emit-cpp] <vocab.json> <output>" << std::endl;
+        return 1;
+    }
+
+    const char *input = argv[argc - 2];
+    const char *output = argv[argc - 1];
+    try {
+        if (emit_cpp)
+            write_embedded_vocab_source(input, output);
+        else
+            compile_vocab(input, output);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << (emit_cpp ? "Embedded vocab source" : "Binary vocab") << " written to " << output
+              << std::endl;
+    return 0;
+}
@@ -4,14 +4,15 @@
 #include <QRegularExpression>
 #include <QDebug>
 #include <QResizeEvent>
+#ifndef BUILD_GUI_ONLY
+#include <QtConcurrent/QtConcurrent>
+#endif
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 #ifndef BUILD_GUI_ONLY
-    , tokenizer("../core/opus-mt-en-ru/vocab.json")
     , translatorManager_(new OnlineTranslatorsManager("../requests/api_keys.json"))
-    , translator(nullptr)
 #endif
 {
     ui->setupUi(this);
@@ -19,27 +20,42 @@ MainWindow::MainWindow(QWidget *parent)
     ui->outputTextBrowser->setReadOnly(true);
     connect(ui->translateButton, &QPushButton::clicked, this, &MainWindow::translateText);
     connect(ui->clearButton, &QPushButton::clicked, this, &MainWindow::clearFields);
+    connect(this, &MainWindow::modelsFailedToLoad, this, &MainWindow::showModelLoadErrors,
+            Qt::QueuedConnection);
 #ifndef BUILD_GUI_ONLY
-    try {
-        translator = new Translator(
-            tokenizer,
-            "../core/opus-mt-en-ru/encoder.onnx",
-            "../core/opus-mt-en-ru/decoder.onnx",
-            0,
-            2
-        );
-    } catch (const std::exception& e) {
-        QMessageBox::critical(this, "Error", "Failed to initialize translator: " + QString(e.what()));
-        translator = nullptr;
+    // Модели загружаются один раз; переключение направлений использует уже прогретые сессии.
+    ModelRegistry &registry = ModelRegistry::instance();
+    ModelConfig en_ru = ModelConfig::from_directory("en", "ru", "../core/opus-mt-en-ru");
+    ModelConfig ru_en = ModelConfig::from_directory("ru", "en", "../core/opus-mt-ru-en");
+    std::vector<std::pair<std::string, std::string>> directions;
+    for (ModelConfig *config : {&en_ru, &ru_en}) {
+        config->runtime_options = RuntimeOptions::global();
+        registry.add(*config);
+        directions.emplace_back(config->source_language, config->target_language);
     }
+    // Загрузка идёт в фоне, чтобы окно появилось сразу; перевод до её окончания
+    // ждёт загрузки нужной модели в ModelRegistry::get.
+    preloadFuture_ = QtConcurrent::run([this, directions]() {
+        ModelRegistry &registry = ModelRegistry::instance();
+        if (registry.preload() == 0)
+            return;
+        QStringList errors;
+        for (const auto &[source, target] : directions)
+            if (registry.state(source, target) == ModelState::Failed)
+                errors << QString::fromStdString(source + "-" + target + ": " +
+                                                 registry.error(source, target));
+        emit modelsFailedToLoad(errors.join("\n"));
+    });
 #endif
 }
 
 MainWindow::~MainWindow()
 {
+#ifndef BUILD_GUI_ONLY
+    preloadFuture_.waitForFinished();
+#endif
     delete ui;
 #ifndef BUILD_GUI_ONLY
-    delete translator;
     delete translatorManager_;
 #endif
 }
@@ -78,23 +94,11 @@ void MainWindow::translateText()
     return;
 #else
     try {
-        delete translator;
-        translator = nullptr;
-        if (sourceLang == "Русский" && targetLang == "Английский") {
-            translator = new Translator(
-                tokenizer,
-                "../core/opus-mt-ru-en/encoder.onnx",
-                "../core/opus-mt-ru-en/decoder.onnx",
-                62517, 0, 50, 3
-            );
-        } else if (sourceLang == "Английский" && targetLang == "Русский") {
-            translator = new Translator(
-                tokenizer,
-                "../core/opus-mt-en-ru/encoder.onnx",
-                "../core/opus-mt-en-ru/decoder.onnx",
-                62517, 0, 50, 3
-            );
-        }
+        std::shared_ptr<const Translator> translator;
+        if (sourceLang == "Русский" && targetLang == "Английский")
+            translator = ModelRegistry::instance().get("ru", "en");
+        else if (sourceLang == "Английский" && targetLang == "Русский")
+            translator = ModelRegistry::instance().get("en", "ru");
         if (translator) {
             QString neuralTranslation = QString::fromStdString(translator->run(inputText.toStdString()));
             ui->outputTextBrowser->append("[Локальный] " + neuralTranslation);
@@ -144,6 +148,12 @@ void MainWindow::clearFields()
     ui->sourceLangCombo->setCurrentIndex(0);
 }
 
+void MainWindow::showModelLoadErrors(const QString &message)
+{
+    qDebug() << "Model load errors:" << message;
+    QMessageBox::critical(this, "Error", QString("Не удалось загрузить модели перевода:\n%1").arg(message));
+}
+
 QString MainWindow::detectLanguage(const QString &text)
 {
     if (text.isEmpty()) {
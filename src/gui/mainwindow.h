@@ -10,9 +10,11 @@
 #include <QPlainTextEdit>
 #include <QTextBrowser>
 #include <QPushButton>
+#include <QFuture>
 
 #ifndef BUILD_GUI_ONLY
 #include "translator.hpp"
+#include "translator/model_registry.hpp"
 #include "online_translators.hpp"
 #include "tokenizer.hpp"
 #endif
@@ -60,6 +62,16 @@ public:
      */
     bool validateInput(const QString &text, const QString &language);
 
+signals:
+    /**
+     * @brief Сигнал о моделях, которые не удалось загрузить
+     * @param message Ошибки загрузки, по одной строке на модель
+     *
+     * Испускается из фонового потока загрузки; доставляется в поток окна
+     * через очередь событий.
+     */
+    void modelsFailedToLoad(const QString &message);
+
 private slots:
     /**
      * @brief Слот для перевода текста
@@ -76,12 +88,17 @@ private slots:
      */
     void clearFields();
 
+    /**
+     * @brief Слот для показа ошибок загрузки моделей
+     * @param message Ошибки загрузки, по одной строке на модель
+     */
+    void showModelLoadErrors(const QString &message);
+
 private:
     Ui::MainWindow *ui;
 #ifndef BUILD_GUI_ONLY
-    Tokenizer tokenizer; 
-    Translator* translator; 
     OnlineTranslatorsManager* translatorManager_; 
+    QFuture<void> preloadFuture_; ///< Фоновая загрузка моделей; деструктор дожидается её завершения.
 #endif
 };
 